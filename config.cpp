@@ -0,0 +1,221 @@
+#include "config.hpp"
+#include "smoothing.hpp"
+#include <filesystem>
+#include <iostream>
+#include <unistd.h>
+
+/*
+optional typed keys, true if missing or valid
+*/
+static bool get_double(GKeyFile *key_file, const char *group, const char *key, float &value)
+{
+  if (!g_key_file_has_key(key_file, group, key, NULL))
+    return true;
+  GError *error = NULL;
+  auto result = g_key_file_get_double(key_file, group, key, &error);
+  if (error != NULL)
+  {
+    std::cout << "config: " << group << "." << key << " " << error->message << std::endl;
+    g_error_free(error);
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+static bool get_string(GKeyFile *key_file, const char *group, const char *key, std::string &value)
+{
+  if (!g_key_file_has_key(key_file, group, key, NULL))
+    return true;
+  auto result = g_key_file_get_string(key_file, group, key, NULL);
+  if (result == NULL)
+    return false;
+  value = result;
+  g_free(result);
+  return true;
+}
+
+static bool get_bool(GKeyFile *key_file, const char *group, const char *key, bool &value)
+{
+  if (!g_key_file_has_key(key_file, group, key, NULL))
+    return true;
+  GError *error = NULL;
+  auto result = g_key_file_get_boolean(key_file, group, key, &error);
+  if (error != NULL)
+  {
+    std::cout << "config: " << group << "." << key << " " << error->message << std::endl;
+    g_error_free(error);
+    return false;
+  }
+  value = result;
+  return true;
+}
+
+static bool get_curve(GKeyFile *key_file, const char *group, const char *key, CurveSpec &spec)
+{
+  std::string text;
+  if (!get_string(key_file, group, key, text))
+    return false;
+  if (text.empty() || parse_curve_spec(text, spec))
+    return true;
+  std::cout << "config: invalid curve " << group << "." << key << "=" << text << std::endl;
+  return false;
+}
+
+Config *load_config(const char *path, libevdev *src_dev, libevdev *fn_dev)
+{
+  GError *error = NULL;
+  auto key_file = g_key_file_new();
+  if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, &error))
+  {
+    std::cout << "load config err! " << error->message << std::endl;
+    g_error_free(error);
+    g_key_file_free(key_file);
+    return nullptr;
+  }
+
+  auto config = new Config();
+  bool ok = true;
+  float deadzone = config->gyro_deadzone;
+  ok &= get_double(key_file, "gyro", "deadzone", deadzone);
+  if (!(deadzone >= 0 && deadzone <= 32767))
+  {
+    std::cout << "config: gyro deadzone out of range" << std::endl;
+    ok = false;
+  }
+  else
+    config->gyro_deadzone = deadzone;
+  ok &= get_string(key_file, "gyro", "smoothing", config->smoothing);
+  if (!make_smoother(config->smoothing))
+  {
+    std::cout << "config: unknown smoothing " << config->smoothing << std::endl;
+    ok = false;
+  }
+
+  std::string space = gyro_space_name(config->gyro_space);
+  ok &= get_string(key_file, "gyro", "space", space);
+  if (!parse_gyro_space(space, config->gyro_space))
+  {
+    std::cout << "config: unknown gyro space " << space << std::endl;
+    ok = false;
+  }
+
+  ok &= get_bool(key_file, "gyro", "power_save", config->power_save);
+
+  auto &sensitivity = config->sensitivity_spec;
+  ok &= get_double(key_file, "gyro", "slow_factor", sensitivity.out_min);
+  ok &= get_double(key_file, "gyro", "fast_factor", sensitivity.out_max);
+  ok &= get_double(key_file, "gyro", "speed_min", sensitivity.in_min);
+  ok &= get_double(key_file, "gyro", "speed_max", sensitivity.in_max);
+  ok &= get_curve(key_file, "gyro", "sensitivity_curve", sensitivity);
+
+  auto gyro_spec = config->gyro_curve.getSpec();
+  ok &= get_curve(key_file, "gyro", "curve", gyro_spec);
+  config->gyro_curve = ResponseCurve(gyro_spec);
+  auto mouse_spec = config->mouse_curve.getSpec();
+  ok &= get_curve(key_file, "pointer", "curve", mouse_spec);
+  config->mouse_curve = ResponseCurve(mouse_spec);
+  float pointer_deadzone = config->pointer_deadzone;
+  ok &= get_double(key_file, "pointer", "deadzone", pointer_deadzone);
+  config->pointer_deadzone = pointer_deadzone;
+  float pointer_rate = config->pointer_rate;
+  ok &= get_double(key_file, "pointer", "rate", pointer_rate);
+  config->pointer_rate = pointer_rate;
+  if (config->pointer_rate < 10 || config->pointer_rate > 1000 ||
+      config->pointer_deadzone < 0 || config->pointer_deadzone >= 32768)
+  {
+    std::cout << "config: pointer rate or deadzone out of range" << std::endl;
+    ok = false;
+  }
+  ok &= get_double(key_file, "pointer", "scroll_speed", config->scroll_speed);
+
+  ok &= get_string(key_file, "imu", "backend", config->imu_backend);
+  ok &= get_string(key_file, "imu", "device", config->imu_device);
+  if (!IMU::isBackend(config->imu_backend))
+  {
+    std::cout << "config: unknown imu backend " << config->imu_backend << std::endl;
+    ok = false;
+  }
+
+  ok &= config->js_mapping.load(key_file, "joystick", src_dev);
+  ok &= config->mouse_mapping.load(key_file, "mouse", src_dev);
+  ok &= config->fn_mapping.load(key_file, "fn", fn_dev);
+  ok &= config->gesture_mapping.load_gestures(key_file, "gestures");
+  g_key_file_free(key_file);
+
+  if (!ok)
+  {
+    std::cout << "invalid config " << path << std::endl;
+    delete config;
+    return nullptr;
+  }
+  return config;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string &path,
+                             libevdev *src_dev,
+                             libevdev *fn_dev,
+                             std::function<void(Config *)> on_change) : path(path),
+                                                                       src_dev(src_dev),
+                                                                       fn_dev(fn_dev),
+                                                                       on_change(on_change)
+{
+  // editors replace files by rename, so watch the directory
+  auto fs_path = std::filesystem::absolute(path);
+  dir = fs_path.parent_path();
+  name = fs_path.filename();
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0 ||
+      inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    std::cout << "watch config err! " << dir << std::endl;
+    return;
+  }
+
+  auto m_io_channel = g_io_channel_unix_new(inotify_fd);
+  GError *error = NULL;
+  if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+  {
+    std::cout << error->message << std::endl;
+    g_error_free(error);
+  }
+  g_io_channel_set_buffered(m_io_channel, false);
+  g_io_add_watch(m_io_channel,
+                 static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                 &ConfigWatcher::on_inotify_wrap, this);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+  if (inotify_fd >= 0)
+    close(inotify_fd);
+}
+
+gboolean ConfigWatcher::on_inotify(GIOChannel *source, GIOCondition condition)
+{
+  alignas(inotify_event) char buf[4096];
+  bool changed = false;
+  ssize_t rd = 0;
+  while ((rd = ::read(inotify_fd, buf, sizeof(buf))) > 0)
+  {
+    for (char *ptr = buf; ptr < buf + rd;)
+    {
+      auto event = reinterpret_cast<inotify_event *>(ptr);
+      if (event->len > 0 && name == event->name)
+        changed = true;
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+  if (changed)
+  {
+    auto config = load_config(path.c_str(), src_dev, fn_dev);
+    if (config != nullptr)
+    {
+      std::cout << "config reloaded" << std::endl;
+      on_change(config);
+    }
+    else
+      std::cout << "config rejected, keep running config" << std::endl;
+  }
+  return TRUE;
+}
@@ -0,0 +1,94 @@
+#ifndef CONFIG_HEADER
+#define CONFIG_HEADER
+#include <glib.h>
+#include <sys/inotify.h>
+#include <functional>
+#include <string>
+#include "imu/imu.h"
+#include "mapping.hpp"
+
+#define DEFAULT_CONFIG_PATH "/etc/oxp_gyro_key_mapper.conf"
+
+/*
+the original 0.1..1.8 -> 0..22000 line, carried on to full deflection
+since curves stop at in_max
+*/
+inline CurveSpec default_gyro_curve_spec()
+{
+    return CurveSpec{.type = CURVE_LINEAR,
+                     .in_min = 0.1,
+                     .in_max = 0.1f + 1.7f * 32767 / 22000,
+                     .out_min = 0,
+                     .out_max = 32767};
+}
+
+/*
+Everything that can be tuned at runtime, read from a key file:
+  [gyro]     deadzone, smoothing, space, power_save, slow_factor, fast_factor, speed_min,
+             speed_max, sensitivity_curve, curve
+  [pointer]  curve, deadzone, rate, scroll_speed
+  [imu]      backend, device (startup only)
+  [joystick] [mouse] [fn] [gestures] mappings, see README
+Missing keys keep their defaults.
+*/
+struct Config
+{
+    int gyro_deadzone = 9000;
+    std::string smoothing = "one-euro";
+    GyroSpace gyro_space = GYRO_LOCAL;
+    // suspend the IMU when nothing needs motion and while it lies still
+    bool power_save = true;
+    // gyro speed (dps) -> sensitivity factor
+    CurveSpec sensitivity_spec = IMU::defaultSensitivitySpec();
+    // gyro motion per tick -> stick deflection
+    ResponseCurve gyro_curve = ResponseCurve(default_gyro_curve_spec());
+    // stick deflection -> pixels per 10ms, squared for fine aiming
+    ResponseCurve mouse_curve = ResponseCurve(CurveSpec{
+        .type = CURVE_POWER, .in_min = 0, .in_max = 32768, .out_min = 0, .out_max = 10, .exponent = 2});
+    // radial, on the stick deflection
+    int pointer_deadzone = 4000;
+    // pointer ticks per second, 10 to 1000
+    int pointer_rate = 500;
+    // wheel detents per second at full deflection
+    float scroll_speed = 8;
+    // auto, i2c, iio, sim or replay, device is the iio sysfs dir or replay file
+    std::string imu_backend = "auto";
+    std::string imu_device;
+    Mapping js_mapping = Mapping::default_js();
+    Mapping mouse_mapping = Mapping::default_mouse();
+    Mapping fn_mapping = Mapping::default_fn();
+    Mapping gesture_mapping = Mapping::default_gestures();
+};
+
+// nullptr if the file can not be read or has an invalid entry
+Config *load_config(const char *path, libevdev *src_dev, libevdev *fn_dev);
+
+/*
+watch the config file with inotify and hand every valid new version to
+on_change, invalid versions are reported and dropped
+*/
+class ConfigWatcher
+{
+private:
+    std::string path, dir, name;
+    int inotify_fd;
+    libevdev *src_dev;
+    libevdev *fn_dev;
+    std::function<void(Config *)> on_change;
+
+public:
+    ConfigWatcher(const std::string &path,
+                  libevdev *src_dev,
+                  libevdev *fn_dev,
+                  std::function<void(Config *)> on_change);
+    ~ConfigWatcher();
+    gboolean on_inotify(GIOChannel *source, GIOCondition condition);
+    static gboolean on_inotify_wrap(GIOChannel *source,
+                                    GIOCondition condition,
+                                    gpointer userdata)
+    {
+        return static_cast<ConfigWatcher *>(userdata)->on_inotify(source, condition);
+    }
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "control_server.hpp"
+#include "uinput.hpp"
+#include "smoothing.hpp"
+#include <charconv>
+#include <sstream>
+#include <unistd.h>
+
+ControlServer::ControlServer(const std::string &path, UInput *uinput, IMU *imu) : path(path),
+                                                                                  uinput(uinput),
+                                                                                  imu(imu),
+                                                                                  start_time(std::chrono::steady_clock::now())
+{
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (listen_fd < 0 || path.size() >= sizeof(addr.sun_path))
+  {
+    std::cout << "control socket err!" << std::endl;
+    return;
+  }
+  path.copy(addr.sun_path, path.size());
+  unlink(path.c_str());
+  if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd, 8) != 0)
+  {
+    std::cout << "control bind err! " << path << std::endl;
+    close(listen_fd);
+    listen_fd = -1;
+    return;
+  }
+
+  auto m_io_channel = g_io_channel_unix_new(listen_fd);
+  g_io_add_watch(m_io_channel,
+                 static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                 &ControlServer::on_accept_wrap, this);
+  g_io_channel_unref(m_io_channel);
+}
+
+ControlServer::~ControlServer()
+{
+  while (!clients.empty())
+    drop(clients.begin()->first);
+  if (listen_fd >= 0)
+  {
+    close(listen_fd);
+    unlink(path.c_str());
+  }
+}
+
+gboolean ControlServer::on_accept(GIOChannel *source, GIOCondition condition)
+{
+  int fd;
+  while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+  {
+    auto m_io_channel = g_io_channel_unix_new(fd);
+    g_io_channel_set_encoding(m_io_channel, NULL, NULL);
+    g_io_channel_set_buffered(m_io_channel, false);
+    auto watch = g_io_add_watch(m_io_channel,
+                                static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                                &ControlServer::on_client_wrap, this);
+    g_io_channel_unref(m_io_channel);
+    clients[fd] = ControlClient{fd, watch, 0, "", ""};
+  }
+  return TRUE;
+}
+
+void ControlServer::drop(int fd)
+{
+  auto it = clients.find(fd);
+  if (it == clients.end())
+    return;
+  if (it->second.read_watch)
+    g_source_remove(it->second.read_watch);
+  if (it->second.write_watch)
+    g_source_remove(it->second.write_watch);
+  close(fd);
+  clients.erase(it);
+}
+
+void ControlServer::flush(ControlClient &client)
+{
+  while (!client.out.empty())
+  {
+    auto sent = send(client.fd, client.out.data(), client.out.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent <= 0)
+      break;
+    client.out.erase(0, sent);
+  }
+}
+
+gboolean ControlServer::on_client(GIOChannel *source, GIOCondition condition)
+{
+  int fd = g_io_channel_unix_get_fd(source);
+  auto it = clients.find(fd);
+  if (it == clients.end())
+    return FALSE;
+  auto &client = it->second;
+
+  // write watch, only installed while replies are pending
+  if (condition & G_IO_OUT)
+  {
+    flush(client);
+    if (!client.out.empty())
+      return TRUE;
+    client.write_watch = 0;
+    return FALSE;
+  }
+
+  char buf[512];
+  ssize_t rd = 0;
+  bool closed = (condition & (G_IO_ERR | G_IO_HUP)) != 0;
+  while ((rd = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+    client.in.append(buf, rd);
+  if (rd == 0)
+    closed = true;
+
+  size_t pos;
+  while ((pos = client.in.find('\n')) != std::string::npos)
+  {
+    auto line = client.in.substr(0, pos);
+    client.in.erase(0, pos + 1);
+    client.out += handle_command(line) + "\n";
+  }
+  flush(client);
+
+  if (closed || client.in.size() > CONTROL_MAX_LINE || client.out.size() > CONTROL_MAX_PENDING)
+  {
+    // this watch is removed by returning FALSE
+    client.read_watch = 0;
+    drop(fd);
+    return FALSE;
+  }
+  if (!client.out.empty() && client.write_watch == 0)
+  {
+    auto m_io_channel = g_io_channel_unix_new(fd);
+    client.write_watch = g_io_add_watch(m_io_channel, G_IO_OUT, &ControlServer::on_client_wrap, this);
+    g_io_channel_unref(m_io_channel);
+  }
+  return TRUE;
+}
+
+/*
+a whole number in [min, max], false on anything else
+*/
+static bool parse_int(const std::string &text, int min, int max, int &value)
+{
+  int result = 0;
+  auto end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, result);
+  if (ec != std::errc() || ptr != end || result < min || result > max)
+    return false;
+  value = result;
+  return true;
+}
+
+std::string ControlServer::handle_command(const std::string &line)
+{
+  std::stringstream ss(line);
+  std::string cmd, key, value;
+  ss >> cmd >> key;
+  std::getline(ss >> std::ws, value);
+  if (!value.empty() && value.back() == '\r')
+    value.pop_back();
+
+  auto config = uinput->get_config();
+  if (cmd == "help")
+    return "ok get|set gyro|mode|smoothing|space|deadzone, get|set curve gyro|pointer|sensitivity, calibrate reset|start|stop|now, get calibration, stats";
+  if (cmd == "stats")
+  {
+    static const char *power_names[] = {"off", "idle", "active"};
+    auto uptime = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time);
+    std::stringstream reply;
+    reply << "ok samples=" << imu->getSampleCount()
+          << " events=" << uinput->submitted_events.load()
+          << " uptime=" << uptime.count()
+          << " clients=" << clients.size()
+          << " power=" << power_names[imu->getPowerState()];
+    auto health = imu->getHealth();
+    reply << " bus_errors=" << health.bus_errors
+          << " stalls=" << health.stalls
+          << " stuck=" << health.stuck
+          << " overflows=" << health.overflows
+          << " resets=" << health.resets
+          << " resumes=" << health.resumes
+          << " recoveries=" << health.recoveries
+          << " failed_recoveries=" << health.failed_recoveries
+          << " last_outage_ms=" << health.last_outage_ms
+          << " max_outage_ms=" << health.max_outage_ms;
+    return reply.str();
+  }
+  if (cmd == "calibrate")
+  {
+    if (key == "reset")
+      imu->resetCalibration();
+    else if (key == "start")
+      imu->startCalibration();
+    else if (key == "stop")
+      imu->stopCalibration();
+    else if (key == "now")
+      imu->calibrateNow();
+    else
+      return "err calibrate reset|start|stop|now";
+    return "ok";
+  }
+  if (cmd == "get")
+  {
+    if (key == "gyro")
+      return std::string("ok ") + (uinput->get_gyro() ? "1" : "0");
+    if (key == "mode")
+      return std::string("ok ") + (uinput->get_js_mode() ? "joystick" : "mouse");
+    if (key == "smoothing")
+      return "ok " + config->smoothing;
+    if (key == "space")
+      return std::string("ok ") + gyro_space_name(config->gyro_space);
+    if (key == "deadzone")
+      return "ok " + std::to_string(config->gyro_deadzone);
+    if (key == "calibration")
+    {
+      static const char *state_names[] = {"none", "running", "done", "moved"};
+      auto result = imu->getCalibrationResult();
+      std::stringstream reply;
+      reply << "ok " << state_names[result.state] << " " << result.x << " " << result.y << " " << result.z
+            << " " << result.samples;
+      return reply.str();
+    }
+    if (key == "curve" && value == "gyro")
+      return "ok " + format_curve_spec(config->gyro_curve.getSpec());
+    if (key == "curve" && value == "pointer")
+      return "ok " + format_curve_spec(config->mouse_curve.getSpec());
+    if (key == "curve" && value == "sensitivity")
+      return "ok " + format_curve_spec(config->sensitivity_spec);
+    return "err unknown key";
+  }
+  if (cmd == "set")
+  {
+    if (key == "gyro" && (value == "0" || value == "1"))
+    {
+      uinput->set_gyro(value == "1");
+      return "ok";
+    }
+    if (key == "mode" && (value == "joystick" || value == "mouse"))
+    {
+      uinput->set_js_mode(value == "joystick");
+      return "ok";
+    }
+    // everything else is a modified copy of the running config
+    auto new_config = new Config(*config);
+    GyroSpace space;
+    int deadzone;
+    if (key == "smoothing" && make_smoother(value))
+      new_config->smoothing = value;
+    else if (key == "space" && parse_gyro_space(value, space))
+      new_config->gyro_space = space;
+    else if (key == "deadzone" && parse_int(value, 0, 32767, deadzone))
+      new_config->gyro_deadzone = deadzone;
+    else if (key == "curve")
+    {
+      std::stringstream curve_ss(value);
+      std::string which, text;
+      CurveSpec spec;
+      curve_ss >> which >> text;
+      if (!parse_curve_spec(text, spec))
+        which = "";
+      if (which == "gyro")
+        new_config->gyro_curve = ResponseCurve(spec);
+      else if (which == "pointer")
+        new_config->mouse_curve = ResponseCurve(spec);
+      else if (which == "sensitivity")
+        new_config->sensitivity_spec = spec;
+      else
+      {
+        delete new_config;
+        return "err set curve gyro|pointer|sensitivity <spec>";
+      }
+    }
+    else
+    {
+      delete new_config;
+      return "err invalid value";
+    }
+    uinput->set_config(new_config);
+    return "ok";
+  }
+  return "err unknown command";
+}
@@ -0,0 +1,64 @@
+#ifndef CONTROL_SERVER_HEADER
+#define CONTROL_SERVER_HEADER
+#include <glib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <map>
+#include <string>
+#include <chrono>
+#include "imu/imu.h"
+
+class UInput;
+
+#define DEFAULT_CONTROL_PATH "/run/oxp_gyro_key_mapper.sock"
+// clients sending longer lines or not reading their replies are dropped
+#define CONTROL_MAX_LINE (1024)
+#define CONTROL_MAX_PENDING (64 * 1024)
+
+struct ControlClient
+{
+    int fd;
+    guint read_watch;
+    guint write_watch;
+    std::string in, out;
+};
+
+/*
+Line based control socket, one command per line, one reply line per
+command starting with "ok" or "err". Runs on the main loop, so commands
+apply between two input events, and never blocks on a client.
+*/
+class ControlServer
+{
+private:
+    int listen_fd;
+    std::string path;
+    UInput *uinput;
+    IMU *imu;
+    std::map<int, ControlClient> clients;
+    std::chrono::steady_clock::time_point start_time;
+
+    std::string handle_command(const std::string &line);
+    void flush(ControlClient &client);
+    void drop(int fd);
+
+public:
+    ControlServer(const std::string &path, UInput *uinput, IMU *imu);
+    ~ControlServer();
+    gboolean on_accept(GIOChannel *source, GIOCondition condition);
+    static gboolean on_accept_wrap(GIOChannel *source,
+                                   GIOCondition condition,
+                                   gpointer userdata)
+    {
+        return static_cast<ControlServer *>(userdata)->on_accept(source, condition);
+    }
+    gboolean on_client(GIOChannel *source, GIOCondition condition);
+    static gboolean on_client_wrap(GIOChannel *source,
+                                   GIOCondition condition,
+                                   gpointer userdata)
+    {
+        return static_cast<ControlServer *>(userdata)->on_client(source, condition);
+    }
+};
+
+#endif
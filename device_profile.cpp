@@ -0,0 +1,67 @@
+#include "device_profile.hpp"
+#include <linux/input.h>
+#include <ctype.h>
+#include <fstream>
+#include <iostream>
+
+// the default has the inputs of the OXP AMD Mini 5800U the mapper was
+// written for, the IMU is discovered
+static const DeviceProfile default_profile = {
+    "default", "", "",
+    "Microsoft X-Box 360 pad", "AT Translated Set 2 keyboard", KEY_D, KEY_O,
+    "", BMI160_I2C_ADDR, AXIS_REMAP_IDENTITY};
+
+static const DeviceProfile profiles[] = {
+    {"oxp-mini-a07", "ONE-NETBOOK", "ONEXPLAYER mini A07",
+     "Microsoft X-Box 360 pad", "AT Translated Set 2 keyboard", KEY_D, KEY_O,
+     "/dev/i2c-1", 0x68, AXIS_REMAP_IDENTITY},
+};
+
+static const DeviceProfile *active_profile = &default_profile;
+
+// one line sysfs attribute, "" if missing
+static std::string read_dmi_id(const char *attribute)
+{
+  std::ifstream file(std::string(DMI_ID_PATH) + attribute);
+  std::string value;
+  std::getline(file, value);
+  while (!value.empty() && isspace(value.back()))
+    value.pop_back();
+  return value;
+}
+
+const DeviceProfile &detect_device_profile()
+{
+  auto vendor = read_dmi_id("board_vendor");
+  auto board = read_dmi_id("board_name");
+  for (const auto &profile : profiles)
+  {
+    if (vendor == profile.board_vendor &&
+        (profile.board_name[0] == '\0' || board == profile.board_name))
+      return profile;
+  }
+  std::cout << "no device profile for " << vendor << " " << board << ", using default" << std::endl;
+  return default_profile;
+}
+
+const DeviceProfile *find_device_profile(const std::string &name)
+{
+  if (name == default_profile.name)
+    return &default_profile;
+  for (const auto &profile : profiles)
+  {
+    if (name == profile.name)
+      return &profile;
+  }
+  return nullptr;
+}
+
+const DeviceProfile &device_profile()
+{
+  return *active_profile;
+}
+
+void set_device_profile(const DeviceProfile &profile)
+{
+  active_profile = &profile;
+}
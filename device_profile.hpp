@@ -0,0 +1,40 @@
+#ifndef DEVICE_PROFILE_HEADER
+#define DEVICE_PROFILE_HEADER
+#include <stdint.h>
+#include <string>
+#include "imu/imu.h"
+
+#define DMI_ID_PATH "/sys/class/dmi/id/"
+
+/*
+What differs between handhelds, keyed by the DMI board vendor and board
+name: the input devices to grab, the keys the fn buttons send and where
+the IMU sits. An empty board name matches any board of the vendor, the
+first match wins, unknown devices get the default profile.
+*/
+struct DeviceProfile
+{
+    const char *name;
+    const char *board_vendor;
+    const char *board_name;
+    // input device names
+    const char *gamepad;
+    const char *fn_keyboard;
+    uint16_t fn_left, fn_right;
+    // empty if the IMU is discovered
+    const char *imu_bus;
+    uint8_t imu_addr;
+    AxisRemapId imu_axes;
+
+    ImuPlacement imu_placement() const { return {imu_bus, imu_addr, imu_axes}; };
+};
+
+// the profile for this machine's DMI ids
+const DeviceProfile &detect_device_profile();
+// nullptr if there is no profile of that name
+const DeviceProfile *find_device_profile(const std::string &name);
+// the profile picked at startup, the default one until set
+const DeviceProfile &device_profile();
+void set_device_profile(const DeviceProfile &profile);
+
+#endif
@@ -0,0 +1,293 @@
+#include "dsu_server.hpp"
+#include <string.h>
+#include <unistd.h>
+#include <random>
+
+uint32_t dsu_crc32(const uint8_t *data, size_t size)
+{
+  static uint32_t table[256] = {0};
+  if (table[1] == 0)
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  }
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFF;
+}
+
+DsuServer::DsuServer(IMU *imu, int port) : server_id(std::random_device()()),
+                                           imu(imu)
+{
+  // warm up crc table before the sampling thread uses it
+  dsu_crc32(nullptr, 0);
+
+  sock_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sock_fd < 0)
+  {
+    std::cout << "dsu socket err!" << std::endl;
+    return;
+  }
+  // loopback only, emulators run on the device itself
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(sock_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+  {
+    std::cout << "dsu bind err!" << std::endl;
+    close(sock_fd);
+    sock_fd = -1;
+    return;
+  }
+
+  // every subscriber gets the same buffers, only the destination differs
+  memset(data_packets, 0, sizeof(data_packets));
+  for (size_t i = 0; i < DSU_BATCH_MAX; i++)
+  {
+    fill_pad_info(data_packets[i].info);
+    data_packets[i].connected = 1;
+    // sticks are centered at 128
+    memset(data_packets[i].sticks, 128, sizeof(data_packets[i].sticks));
+    iovs[i].iov_base = &data_packets[i];
+    iovs[i].iov_len = sizeof(data_packets[i]);
+  }
+  memset(msgs, 0, sizeof(msgs));
+  for (auto &msg : msgs)
+  {
+    msg.msg_hdr.msg_iovlen = 1;
+    msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+  }
+
+  auto m_io_channel = g_io_channel_unix_new(sock_fd);
+  GError *error = NULL;
+  if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+  {
+    std::cout << error->message << std::endl;
+    g_error_free(error);
+  }
+  g_io_channel_set_buffered(m_io_channel, false);
+  g_io_add_watch(m_io_channel,
+                 static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                 &DsuServer::on_read_wrap, this);
+  // the sampler may be stopped, so clients also expire on a timer
+  expire_source = g_timeout_add_seconds(DSU_CLIENT_TIMEOUT_S, &DsuServer::on_expire_wrap, this);
+}
+
+DsuServer::~DsuServer()
+{
+  if (expire_source)
+    g_source_remove(expire_source);
+  if (sock_fd >= 0)
+    close(sock_fd);
+}
+
+void DsuServer::fill_pad_info(DsuPadInfo &info)
+{
+  info.slot = 0;
+  info.state = 2;
+  info.model = 2;
+  info.connection = 1;
+  memset(info.mac, 0, sizeof(info.mac));
+  info.mac[5] = 1;
+  info.battery = 0x05; // full
+}
+
+void DsuServer::finish_packet(DsuHeader &header, size_t size, uint32_t msg_type)
+{
+  memcpy(header.magic, "DSUS", 4);
+  header.version = DSU_PROTOCOL_VERSION;
+  header.length = size - offsetof(DsuHeader, msg_type);
+  header.id = server_id;
+  header.msg_type = msg_type;
+  header.crc32 = 0;
+  header.crc32 = dsu_crc32(reinterpret_cast<uint8_t *>(&header), size);
+}
+
+void DsuServer::send_to(const void *packet, size_t size, const sockaddr_in &addr)
+{
+  sendto(sock_fd, packet, size, MSG_DONTWAIT,
+         reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+}
+
+gboolean DsuServer::on_read(GIOChannel *source, GIOCondition condition)
+{
+  uint8_t buf[128];
+  sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  ssize_t rd = 0;
+  while ((rd = recvfrom(sock_fd, buf, sizeof(buf), 0,
+                        reinterpret_cast<sockaddr *>(&addr), &addr_len)) > 0)
+  {
+    handle_request(buf, rd, addr);
+    addr_len = sizeof(addr);
+  }
+  return TRUE;
+}
+
+void DsuServer::handle_request(const uint8_t *buf, size_t size, const sockaddr_in &addr)
+{
+  DsuHeader header;
+  if (size < sizeof(header))
+    return;
+  memcpy(&header, buf, sizeof(header));
+  if (memcmp(header.magic, "DSUC", 4) != 0 ||
+      header.version > DSU_PROTOCOL_VERSION ||
+      header.length + offsetof(DsuHeader, msg_type) > size)
+    return;
+  size = header.length + offsetof(DsuHeader, msg_type);
+
+  // crc is computed with the crc field zeroed
+  uint8_t check[128];
+  memcpy(check, buf, size);
+  memset(check + offsetof(DsuHeader, crc32), 0, sizeof(header.crc32));
+  if (dsu_crc32(check, size) != header.crc32)
+    return;
+
+  auto payload = buf + sizeof(header);
+  auto payload_size = size - sizeof(header);
+  switch (header.msg_type)
+  {
+  case DSU_MSG_VERSION:
+  {
+    struct __attribute__((packed))
+    {
+      DsuHeader header;
+      uint16_t version;
+    } packet;
+    packet.version = DSU_PROTOCOL_VERSION;
+    finish_packet(packet.header, sizeof(packet), DSU_MSG_VERSION);
+    send_to(&packet, sizeof(packet), addr);
+  }
+  break;
+  case DSU_MSG_PORTS:
+  {
+    int32_t count;
+    if (payload_size < sizeof(count))
+      return;
+    memcpy(&count, payload, sizeof(count));
+    count = std::clamp<int32_t>(count, 0, payload_size - sizeof(count));
+    for (int32_t i = 0; i < count; i++)
+    {
+      // we only ever expose slot 0
+      if (payload[sizeof(count) + i] != 0)
+        continue;
+      struct __attribute__((packed))
+      {
+        DsuHeader header;
+        DsuPadInfo info;
+        uint8_t zero;
+      } packet;
+      fill_pad_info(packet.info);
+      packet.zero = 0;
+      finish_packet(packet.header, sizeof(packet), DSU_MSG_PORTS);
+      send_to(&packet, sizeof(packet), addr);
+    }
+  }
+  break;
+  case DSU_MSG_DATA:
+  {
+    // flags: 0 = all pads, 1 = by slot, 2 = by mac
+    if (payload_size < 2 || (payload[0] == 1 && payload[1] != 0))
+      return;
+    std::lock_guard<std::mutex> lock(clients_lock);
+    auto now = std::chrono::steady_clock::now();
+    for (auto &client : clients)
+    {
+      if (client.addr.sin_addr.s_addr == addr.sin_addr.s_addr &&
+          client.addr.sin_port == addr.sin_port)
+      {
+        client.last_request = now;
+        return;
+      }
+    }
+    if (clients.size() < DSU_MAX_CLIENTS)
+    {
+      clients.emplace_back(DsuClient{addr, now});
+      imu->setDemand(IMU_DEMAND_DSU, true);
+    }
+  }
+  break;
+  default:
+    break;
+  }
+}
+
+/* drop clients that stopped asking for data, caller holds clients_lock */
+void DsuServer::expire_clients(std::chrono::steady_clock::time_point now)
+{
+  auto expired = std::erase_if(clients, [&](const DsuClient &client)
+                               { return now - client.last_request > std::chrono::seconds(DSU_CLIENT_TIMEOUT_S); });
+  if (expired && clients.empty())
+    imu->setDemand(IMU_DEMAND_DSU, false);
+}
+
+gboolean DsuServer::on_expire()
+{
+  std::lock_guard<std::mutex> lock(clients_lock);
+  expire_clients(std::chrono::steady_clock::now());
+  return TRUE;
+}
+
+/*
+called on the IMU sampling thread, one packet is built per sample and
+queued until the end of the read
+*/
+void DsuServer::on_motion_sample(const MotionSample &sample)
+{
+  std::lock_guard<std::mutex> lock(clients_lock);
+  expire_clients(std::chrono::steady_clock::now());
+  if (clients.empty())
+  {
+    queued = 0;
+    return;
+  }
+
+  auto &data_packet = data_packets[queued++];
+  data_packet.packet_number = ++packet_number;
+  data_packet.motion_timestamp = static_cast<uint64_t>(sample.timestamp * 1e6);
+  data_packet.accel_x = sample.accel_x;
+  data_packet.accel_y = sample.accel_y;
+  data_packet.accel_z = sample.accel_z;
+  // same device axes the stick mapping uses for yaw/pitch
+  data_packet.gyro_pitch = sample.gyro_y;
+  data_packet.gyro_yaw = sample.gyro_x;
+  data_packet.gyro_roll = sample.gyro_z;
+  finish_packet(data_packet.header, sizeof(data_packet), DSU_MSG_DATA);
+  if (queued == DSU_BATCH_MAX)
+    flush();
+}
+
+/* called on the IMU sampling thread once a read's samples are queued */
+void DsuServer::on_tick()
+{
+  std::lock_guard<std::mutex> lock(clients_lock);
+  flush();
+}
+
+/*
+the queued packets to all subscribers with a single sendmmsg, caller
+holds clients_lock
+*/
+void DsuServer::flush()
+{
+  size_t count = 0;
+  for (auto &client : clients)
+  {
+    for (size_t i = 0; i < queued; i++)
+    {
+      msgs[count].msg_hdr.msg_name = &client.addr;
+      msgs[count].msg_hdr.msg_iov = &iovs[i];
+      count++;
+    }
+  }
+  if (count > 0)
+    sendmmsg(sock_fd, msgs, count, MSG_DONTWAIT);
+  queued = 0;
+}
@@ -0,0 +1,116 @@
+#ifndef DSU_SERVER_HEADER
+#define DSU_SERVER_HEADER
+#include <glib.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <iostream>
+#include "imu/imu.h"
+
+// cemuhook motion protocol, see https://v1993.github.io/cemuhook-protocol/
+#define DSU_DEFAULT_PORT (26760)
+#define DSU_PROTOCOL_VERSION (1001)
+#define DSU_MSG_VERSION (0x100000)
+#define DSU_MSG_PORTS (0x100001)
+#define DSU_MSG_DATA (0x100002)
+// clients have to renew their subscription within this time
+#define DSU_CLIENT_TIMEOUT_S (5)
+#define DSU_MAX_CLIENTS (8)
+// packets queued over one IMU read, sent early if a burst has more
+#define DSU_BATCH_MAX (IMU_READ_MAX)
+
+#pragma pack(push, 1)
+struct DsuHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t length; // packet length without header
+    uint32_t crc32;
+    uint32_t id;
+    uint32_t msg_type;
+};
+
+struct DsuPadInfo
+{
+    uint8_t slot;
+    uint8_t state;  // 2 = connected
+    uint8_t model;  // 2 = full gyro
+    uint8_t connection; // 1 = usb
+    uint8_t mac[6];
+    uint8_t battery;
+};
+
+struct DsuDataPacket
+{
+    DsuHeader header;
+    DsuPadInfo info;
+    uint8_t connected;
+    uint32_t packet_number;
+    uint8_t buttons[4];
+    uint8_t sticks[4];
+    uint8_t analog_buttons[12];
+    uint8_t touch[12];
+    uint64_t motion_timestamp; // us
+    float accel_x, accel_y, accel_z;          // g
+    float gyro_pitch, gyro_yaw, gyro_roll;    // dps
+};
+#pragma pack(pop)
+
+struct DsuClient
+{
+    sockaddr_in addr;
+    std::chrono::steady_clock::time_point last_request;
+};
+
+class DsuServer
+{
+private:
+    int sock_fd;
+    guint expire_source = 0;
+    uint32_t server_id;
+    // the IMU only runs while someone is subscribed
+    IMU *imu;
+    // preallocated, only touched by the IMU sampling thread
+    DsuDataPacket data_packets[DSU_BATCH_MAX];
+    size_t queued = 0;
+    uint32_t packet_number = 0;
+    mmsghdr msgs[DSU_MAX_CLIENTS * DSU_BATCH_MAX];
+    iovec iovs[DSU_BATCH_MAX];
+
+    // subscribed clients, written from main loop, read from sampling thread
+    std::mutex clients_lock;
+    std::vector<DsuClient> clients;
+
+    void fill_pad_info(DsuPadInfo &info);
+    void finish_packet(DsuHeader &header, size_t size, uint32_t msg_type);
+    void send_to(const void *packet, size_t size, const sockaddr_in &addr);
+    void handle_request(const uint8_t *buf, size_t size, const sockaddr_in &addr);
+    void expire_clients(std::chrono::steady_clock::time_point now);
+    void flush();
+
+public:
+    DsuServer(IMU *imu, int port = DSU_DEFAULT_PORT);
+    ~DsuServer();
+    bool is_open() { return sock_fd >= 0; }
+    void on_motion_sample(const MotionSample &sample);
+    void on_tick();
+    gboolean on_read(GIOChannel *source, GIOCondition condition);
+    static gboolean on_read_wrap(GIOChannel *source,
+                                 GIOCondition condition,
+                                 gpointer userdata)
+    {
+        return static_cast<DsuServer *>(userdata)->on_read(source, condition);
+    }
+    gboolean on_expire();
+    static gboolean on_expire_wrap(gpointer userdata)
+    {
+        return static_cast<DsuServer *>(userdata)->on_expire();
+    }
+};
+
+uint32_t dsu_crc32(const uint8_t *data, size_t size);
+
+#endif
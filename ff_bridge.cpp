@@ -0,0 +1,109 @@
+#include "ff_bridge.hpp"
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+FfBridge::FfBridge(int virt_fd, int phys_fd) : virt_fd(virt_fd),
+                                               phys_fd(phys_fd)
+{
+  effect_ids.fill(-1);
+  // uinput fds are opened blocking, the reader drains until EAGAIN
+  fcntl(virt_fd, F_SETFL, fcntl(virt_fd, F_GETFL) | O_NONBLOCK);
+}
+
+FfBridge::~FfBridge()
+{
+  for (auto &id : effect_ids)
+  {
+    if (id >= 0)
+      ioctl(phys_fd, EVIOCRMFF, id);
+    id = -1;
+  }
+}
+
+bool FfBridge::handle(const input_event &ev)
+{
+  if (ev.type == EV_UINPUT && ev.code == UI_FF_UPLOAD)
+    upload(ev.value);
+  else if (ev.type == EV_UINPUT && ev.code == UI_FF_ERASE)
+    erase(ev.value);
+  else if (ev.type == EV_FF)
+    forward(ev.code, ev.value);
+  else
+    return false;
+  return true;
+}
+
+/*
+copy the effect to the physical device, reusing its id on updates
+*/
+void FfBridge::upload(int request_id)
+{
+  uinput_ff_upload up = {};
+  up.request_id = request_id;
+  if (ioctl(virt_fd, UI_BEGIN_FF_UPLOAD, &up) < 0)
+  {
+    std::cout << "ff begin upload err!" << std::endl;
+    return;
+  }
+
+  int virt_id = up.effect.id;
+  if (virt_id < 0 || virt_id >= FF_BRIDGE_MAX_EFFECTS)
+    up.retval = -ENOSPC;
+  else
+  {
+    ff_effect effect = up.effect;
+    effect.id = effect_ids[virt_id];
+    if (ioctl(phys_fd, EVIOCSFF, &effect) < 0)
+      up.retval = -errno;
+    else
+    {
+      effect_ids[virt_id] = effect.id;
+      up.retval = 0;
+    }
+  }
+
+  if (ioctl(virt_fd, UI_END_FF_UPLOAD, &up) < 0)
+    std::cout << "ff end upload err!" << std::endl;
+}
+
+void FfBridge::erase(int request_id)
+{
+  uinput_ff_erase er = {};
+  er.request_id = request_id;
+  if (ioctl(virt_fd, UI_BEGIN_FF_ERASE, &er) < 0)
+  {
+    std::cout << "ff begin erase err!" << std::endl;
+    return;
+  }
+
+  er.retval = 0;
+  if (er.effect_id < FF_BRIDGE_MAX_EFFECTS && effect_ids[er.effect_id] >= 0)
+  {
+    if (ioctl(phys_fd, EVIOCRMFF, effect_ids[er.effect_id]) < 0)
+      er.retval = -errno;
+    effect_ids[er.effect_id] = -1;
+  }
+
+  if (ioctl(virt_fd, UI_END_FF_ERASE, &er) < 0)
+    std::cout << "ff end erase err!" << std::endl;
+}
+
+/*
+play/stop of an uploaded effect, or a device wide setting like gain
+*/
+void FfBridge::forward(uint16_t code, int32_t value)
+{
+  input_event ev = {};
+  ev.type = EV_FF;
+  ev.value = value;
+  if (code == FF_GAIN || code == FF_AUTOCENTER)
+    ev.code = code;
+  else if (code < FF_BRIDGE_MAX_EFFECTS && effect_ids[code] >= 0)
+    ev.code = effect_ids[code];
+  else
+    return;
+  if (write(phys_fd, &ev, sizeof(ev)) != sizeof(ev))
+    std::cout << "ff write err!" << std::endl;
+}
@@ -0,0 +1,36 @@
+#ifndef FF_BRIDGE_HEADER
+#define FF_BRIDGE_HEADER
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <array>
+#include <iostream>
+
+// effect slots of the virtual device, uinput hands out ids below this
+#define FF_BRIDGE_MAX_EFFECTS (16)
+
+/*
+Mirrors force feedback effects from a uinput device onto a physical evdev
+device. Uploads and erases requested on the virtual device are replayed
+with EVIOCSFF/EVIOCRMFF, play/stop and gain are forwarded as they arrive.
+Only needs the two fds, so it works with any pair of devices.
+*/
+class FfBridge
+{
+private:
+    int virt_fd;
+    int phys_fd;
+    // virtual effect id -> physical effect id, -1 if unused
+    std::array<int16_t, FF_BRIDGE_MAX_EFFECTS> effect_ids;
+
+    void upload(int request_id);
+    void erase(int request_id);
+    void forward(uint16_t code, int32_t value);
+
+public:
+    FfBridge(int virt_fd, int phys_fd);
+    ~FfBridge();
+    // one event read from the virtual device, false if not FF related
+    bool handle(const input_event &ev);
+};
+
+#endif
@@ -11,7 +11,6 @@
 // You don't need to look at these. These will just be used internally by the GamepadMotion class declared below.
 // You can ignore anything in namespace GamepadMotionHelpers.
 class GamepadMotionSettings;
-class GamepadMotion;
 
 namespace GamepadMotionHelpers
 {
@@ -103,12 +102,13 @@ namespace GamepadMotionHelpers
 		Vec PreviousAccel;
 
 		AutoCalibration();
-		bool AddSampleStillness(const Vec& inGyro, const Vec& inAccel, float deltaTime, bool doSensorFusion);
+		template<typename SettingsT>
+		bool AddSampleStillness(const SettingsT& settings, const Vec& inGyro, const Vec& inAccel, float deltaTime, bool doSensorFusion);
 		void NoSampleStillness();
-		bool AddSampleSensorFusion(const Vec& inGyro, const Vec& inAccel, float deltaTime);
+		template<typename SettingsT>
+		bool AddSampleSensorFusion(const SettingsT& settings, const Vec& inGyro, const Vec& inAccel, float deltaTime);
 		void NoSampleSensorFusion();
 		void SetCalibrationData(GyroCalibration* calibrationData);
-		void SetSettings(GamepadMotionSettings* settings);
 
 	private:
 		Vec MinDeltaGyro = Vec(10.f);
@@ -119,7 +119,6 @@ namespace GamepadMotionHelpers
 		float TimeSteadyStillness = 0.f;
 
 		GyroCalibration* CalibrationData;
-		GamepadMotionSettings* Settings;
 	};
 
 	struct Motion
@@ -135,11 +134,8 @@ namespace GamepadMotionHelpers
 
 		Motion();
 		void Reset();
-		void Update(float inGyroX, float inGyroY, float inGyroZ, float inAccelX, float inAccelY, float inAccelZ, float gravityLength, float deltaTime);
-		void SetSettings(GamepadMotionSettings* settings);
-
-	private:
-		GamepadMotionSettings* Settings;
+		template<typename SettingsT>
+		void Update(const SettingsT& settings, float inGyroX, float inGyroY, float inGyroZ, float inAccelX, float inAccelY, float inAccelZ, float gravityLength, float deltaTime);
 	};
 
 	enum CalibrationMode
@@ -150,17 +146,17 @@ namespace GamepadMotionHelpers
 	};
 	
 	// https://stackoverflow.com/a/1448478/1130520
-	inline CalibrationMode operator|(CalibrationMode a, CalibrationMode b)
+	constexpr CalibrationMode operator|(CalibrationMode a, CalibrationMode b)
 	{
 	    return static_cast<CalibrationMode>(static_cast<int>(a) | static_cast<int>(b));
 	}
 	
-	inline CalibrationMode operator&(CalibrationMode a, CalibrationMode b)
+	constexpr CalibrationMode operator&(CalibrationMode a, CalibrationMode b)
 	{
 	    return static_cast<CalibrationMode>(static_cast<int>(a) & static_cast<int>(b));
 	}
 	
-	inline CalibrationMode operator~(CalibrationMode a)
+	constexpr CalibrationMode operator~(CalibrationMode a)
 	{
 		return static_cast<CalibrationMode>(~static_cast<int>(a));
 	}
@@ -175,6 +171,19 @@ namespace GamepadMotionHelpers
 	{
 		return (CalibrationMode&)((int&)(a) &= static_cast<int>(b));
 	}
+
+	// calibration mode chosen at runtime with SetCalibrationMode
+	struct RuntimeCalibrationMode
+	{
+		CalibrationMode Value = CalibrationMode::Manual;
+	};
+
+	// calibration mode fixed at compile time, branches on it fold away
+	template<CalibrationMode Mode>
+	struct FixedCalibrationMode
+	{
+		static constexpr CalibrationMode Value = Mode;
+	};
 }
 
 // Note that I'm using a Y-up coordinate system. This is to follow the convention set by the motion sensors in
@@ -218,10 +227,51 @@ public:
 	float GravityCorrectionMinimumSpeed = 0.01f;
 };
 
-class GamepadMotion
+// The defaults of GamepadMotionSettings as compile time constants. Derive from it and shadow members to tune:
+// struct MySettings : ConstGamepadMotionSettings { static constexpr float StillnessGyroDelta = 0.5f; };
+struct ConstGamepadMotionSettings
+{
+	static constexpr GamepadMotionSettings Defaults{};
+
+	static constexpr int MinStillnessSamples = Defaults.MinStillnessSamples;
+	static constexpr float MinStillnessCollectionTime = Defaults.MinStillnessCollectionTime;
+	static constexpr float MinStillnessCorrectionTime = Defaults.MinStillnessCorrectionTime;
+	static constexpr float MaxStillnessError = Defaults.MaxStillnessError;
+	static constexpr float StillnessSampleDeteriorationRate = Defaults.StillnessSampleDeteriorationRate;
+	static constexpr float StillnessErrorClimbRate = Defaults.StillnessErrorClimbRate;
+	static constexpr float StillnessErrorDropOnRecalibrate = Defaults.StillnessErrorDropOnRecalibrate;
+	static constexpr float StillnessCalibrationEaseInTime = Defaults.StillnessCalibrationEaseInTime;
+	static constexpr float StillnessCalibrationHalfTime = Defaults.StillnessCalibrationHalfTime;
+
+	static constexpr float StillnessGyroDelta = Defaults.StillnessGyroDelta;
+	static constexpr float StillnessAccelDelta = Defaults.StillnessAccelDelta;
+
+	static constexpr float SensorFusionCalibrationSmoothingStrength = Defaults.SensorFusionCalibrationSmoothingStrength;
+	static constexpr float SensorFusionAngularAccelerationThreshold = Defaults.SensorFusionAngularAccelerationThreshold;
+	static constexpr float SensorFusionCalibrationEaseInTime = Defaults.SensorFusionCalibrationEaseInTime;
+	static constexpr float SensorFusionCalibrationHalfTime = Defaults.SensorFusionCalibrationHalfTime;
+
+	static constexpr float GravityCorrectionShakinessMaxThreshold = Defaults.GravityCorrectionShakinessMaxThreshold;
+	static constexpr float GravityCorrectionShakinessMinThreshold = Defaults.GravityCorrectionShakinessMinThreshold;
+
+	static constexpr float GravityCorrectionStillSpeed = Defaults.GravityCorrectionStillSpeed;
+	static constexpr float GravityCorrectionShakySpeed = Defaults.GravityCorrectionShakySpeed;
+
+	static constexpr float GravityCorrectionGyroFactor = Defaults.GravityCorrectionGyroFactor;
+	static constexpr float GravityCorrectionGyroMinThreshold = Defaults.GravityCorrectionGyroMinThreshold;
+	static constexpr float GravityCorrectionGyroMaxThreshold = Defaults.GravityCorrectionGyroMaxThreshold;
+
+	static constexpr float GravityCorrectionMinimumSpeed = Defaults.GravityCorrectionMinimumSpeed;
+};
+
+// SettingsT is GamepadMotionSettings (tunable at runtime) or a ConstGamepadMotionSettings type, CalibrationModeT is
+// RuntimeCalibrationMode or FixedCalibrationMode<...>. The compile time variants let the compiler fold the settings
+// and drop calibration branches that can't be taken. GamepadMotion is the runtime configurable variant.
+template<typename SettingsT, typename CalibrationModeT>
+class BasicGamepadMotion
 {
 public:
-	GamepadMotion();
+	BasicGamepadMotion();
 
 	void Reset();
 
@@ -246,7 +296,7 @@ public:
 
 	void ResetMotion();
 
-	GamepadMotionSettings Settings;
+	SettingsT Settings;
 
 private:
 	GamepadMotionHelpers::Vec Gyro;
@@ -254,13 +304,15 @@ private:
 	GamepadMotionHelpers::Motion Motion;
 	GamepadMotionHelpers::GyroCalibration GyroCalibration;
 	GamepadMotionHelpers::AutoCalibration AutoCalibration;
-	GamepadMotionHelpers::CalibrationMode CurrentCalibrationMode;
+	CalibrationModeT CurrentCalibrationMode;
 
 	bool IsCalibrating;
 	void PushSensorSamples(float gyroX, float gyroY, float gyroZ, float accelMagnitude);
 	void GetCalibratedSensor(float& gyroOffsetX, float& gyroOffsetY, float& gyroOffsetZ, float& accelMagnitude);
 };
 
+typedef BasicGamepadMotion<GamepadMotionSettings, GamepadMotionHelpers::RuntimeCalibrationMode> GamepadMotion;
+
 ///////////// Everything below here are just implementation details /////////////
 
 namespace GamepadMotionHelpers
@@ -543,22 +595,18 @@ namespace GamepadMotionHelpers
 	/// <summary>
 	/// The gyro inputs should be calibrated degrees per second but have no other processing. Acceleration is in G units (1 = approx. 9.8m/s^2)
 	/// </summary>
-	inline void Motion::Update(float inGyroX, float inGyroY, float inGyroZ, float inAccelX, float inAccelY, float inAccelZ, float gravityLength, float deltaTime)
+	template<typename SettingsT>
+	inline void Motion::Update(const SettingsT& settings, float inGyroX, float inGyroY, float inGyroZ, float inAccelX, float inAccelY, float inAccelZ, float gravityLength, float deltaTime)
 	{
-		if (!Settings)
-		{
-			return;
-		}
-
 		// get settings
-		const float gravityCorrectionShakinessMinThreshold = Settings->GravityCorrectionShakinessMinThreshold;
-		const float gravityCorrectionShakinessMaxThreshold = Settings->GravityCorrectionShakinessMaxThreshold;
-		const float gravityCorrectionStillSpeed = Settings->GravityCorrectionStillSpeed;
-		const float gravityCorrectionShakySpeed = Settings->GravityCorrectionShakySpeed;
-		const float gravityCorrectionGyroFactor = Settings->GravityCorrectionGyroFactor;
-		const float gravityCorrectionGyroMinThreshold = Settings->GravityCorrectionGyroMinThreshold;
-		const float gravityCorrectionGyroMaxThreshold = Settings->GravityCorrectionGyroMaxThreshold;
-		const float gravityCorrectionMinimumSpeed = Settings->GravityCorrectionMinimumSpeed;
+		const float gravityCorrectionShakinessMinThreshold = settings.GravityCorrectionShakinessMinThreshold;
+		const float gravityCorrectionShakinessMaxThreshold = settings.GravityCorrectionShakinessMaxThreshold;
+		const float gravityCorrectionStillSpeed = settings.GravityCorrectionStillSpeed;
+		const float gravityCorrectionShakySpeed = settings.GravityCorrectionShakySpeed;
+		const float gravityCorrectionGyroFactor = settings.GravityCorrectionGyroFactor;
+		const float gravityCorrectionGyroMinThreshold = settings.GravityCorrectionGyroMinThreshold;
+		const float gravityCorrectionGyroMaxThreshold = settings.GravityCorrectionGyroMaxThreshold;
+		const float gravityCorrectionMinimumSpeed = settings.GravityCorrectionMinimumSpeed;
 
 		const Vec axis = Vec(inGyroX, inGyroY, inGyroZ);
 		const Vec accel = Vec(inAccelX, inAccelY, inAccelZ);
@@ -642,11 +690,6 @@ namespace GamepadMotionHelpers
 		Quaternion.Normalize();
 	}
 
-	inline void Motion::SetSettings(GamepadMotionSettings* settings)
-	{
-		Settings = settings;
-	}
-
 	inline SensorMinMaxWindow::SensorMinMaxWindow()
 	{
 		Reset(0.f);
@@ -701,7 +744,8 @@ namespace GamepadMotionHelpers
 		TimeSteadyStillness = 0.f;
 	}
 
-	inline bool AutoCalibration::AddSampleStillness(const Vec& inGyro, const Vec& inAccel, float deltaTime, bool doSensorFusion)
+	template<typename SettingsT>
+	inline bool AutoCalibration::AddSampleStillness(const SettingsT& settings, const Vec& inGyro, const Vec& inAccel, float deltaTime, bool doSensorFusion)
 	{
 		if (inGyro.x == 0.f && inGyro.y == 0.f && inGyro.z == 0.f &&
 			inAccel.x == 0.f && inAccel.y == 0.f && inAccel.z == 0.f)
@@ -710,23 +754,18 @@ namespace GamepadMotionHelpers
 			return false;
 		}
 
-		if (!Settings)
-		{
-			return false;
-		}
-
 		// get settings
-		const int minStillnessSamples = Settings->MinStillnessSamples;
-		const float minStillnessCollectionTime = Settings->MinStillnessCollectionTime;
-		const float minStillnessCorrectionTime = Settings->MinStillnessCorrectionTime;
-		const float maxStillnessError = Settings->MaxStillnessError;
-		const float stillnessSampleDeteriorationRate = Settings->StillnessSampleDeteriorationRate;
-		const float stillnessErrorClimbRate = Settings->StillnessErrorClimbRate;
-		const float stillnessErrorDropOnRecalibrate = Settings->StillnessErrorDropOnRecalibrate;
-		const float stillnessCalibrationEaseInTime = Settings->StillnessCalibrationEaseInTime;
-		const float stillnessCalibrationHalfTime = Settings->StillnessCalibrationHalfTime;
-		const float stillnessGyroDelta = Settings->StillnessGyroDelta;
-		const float stillnessAccelDelta = Settings->StillnessAccelDelta;
+		const int minStillnessSamples = settings.MinStillnessSamples;
+		const float minStillnessCollectionTime = settings.MinStillnessCollectionTime;
+		const float minStillnessCorrectionTime = settings.MinStillnessCorrectionTime;
+		const float maxStillnessError = settings.MaxStillnessError;
+		const float stillnessSampleDeteriorationRate = settings.StillnessSampleDeteriorationRate;
+		const float stillnessErrorClimbRate = settings.StillnessErrorClimbRate;
+		const float stillnessErrorDropOnRecalibrate = settings.StillnessErrorDropOnRecalibrate;
+		const float stillnessCalibrationEaseInTime = settings.StillnessCalibrationEaseInTime;
+		const float stillnessCalibrationHalfTime = settings.StillnessCalibrationHalfTime;
+		const float stillnessGyroDelta = settings.StillnessGyroDelta;
+		const float stillnessAccelDelta = settings.StillnessAccelDelta;
 
 		MinMaxWindow.AddSample(inGyro, inAccel, deltaTime);
 		// get deltas
@@ -858,7 +897,8 @@ namespace GamepadMotionHelpers
 		MinMaxWindow.Reset(0.f);
 	}
 
-	inline bool AutoCalibration::AddSampleSensorFusion(const Vec& inGyro, const Vec& inAccel, float deltaTime)
+	template<typename SettingsT>
+	inline bool AutoCalibration::AddSampleSensorFusion(const SettingsT& settings, const Vec& inGyro, const Vec& inAccel, float deltaTime)
 	{
 		if (deltaTime <= 0.f)
 		{
@@ -896,16 +936,11 @@ namespace GamepadMotionHelpers
 			return false;
 		}
 
-		if (!Settings)
-		{
-			return false;
-		}
-
 		// get settings
-		const float sensorFusionCalibrationSmoothingStrength = Settings->SensorFusionCalibrationSmoothingStrength;
-		const float sensorFusionAngularAccelerationThreshold = Settings->SensorFusionAngularAccelerationThreshold;
-		const float sensorFusionCalibrationEaseInTime = Settings->SensorFusionCalibrationEaseInTime;
-		const float sensorFusionCalibrationHalfTime = Settings->SensorFusionCalibrationHalfTime;
+		const float sensorFusionCalibrationSmoothingStrength = settings.SensorFusionCalibrationSmoothingStrength;
+		const float sensorFusionAngularAccelerationThreshold = settings.SensorFusionAngularAccelerationThreshold;
+		const float sensorFusionCalibrationEaseInTime = settings.SensorFusionCalibrationEaseInTime;
+		const float sensorFusionCalibrationHalfTime = settings.SensorFusionCalibrationHalfTime;
 
 		deltaTime += SensorFusionSkippedTime;
 		SensorFusionSkippedTime = 0.f;
@@ -1008,34 +1043,28 @@ namespace GamepadMotionHelpers
 	{
 		CalibrationData = calibrationData;
 	}
-
-	inline void AutoCalibration::SetSettings(GamepadMotionSettings* settings)
-	{
-		Settings = settings;
-	}
-
 } // namespace GamepadMotionHelpers
 
-inline GamepadMotion::GamepadMotion()
+template<typename SettingsT, typename CalibrationModeT>
+inline BasicGamepadMotion<SettingsT, CalibrationModeT>::BasicGamepadMotion()
 {
 	IsCalibrating = false;
-	CurrentCalibrationMode = GamepadMotionHelpers::CalibrationMode::Manual;
 	Reset();
 	AutoCalibration.SetCalibrationData(&GyroCalibration);
-	AutoCalibration.SetSettings(&Settings);
-	Motion.SetSettings(&Settings);
 }
 
-inline void GamepadMotion::Reset()
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::Reset()
 {
 	GyroCalibration = {};
 	Gyro = {};
 	RawAccel = {};
-	Settings = GamepadMotionSettings();
+	Settings = SettingsT();
 	Motion.Reset();
 }
 
-inline void GamepadMotion::ProcessMotion(float gyroX, float gyroY, float gyroZ,
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::ProcessMotion(float gyroX, float gyroY, float gyroZ,
 	float accelX, float accelY, float accelZ, float deltaTime)
 {
 	if (gyroX == 0.f && gyroY == 0.f && gyroZ == 0.f &&
@@ -1054,17 +1083,17 @@ inline void GamepadMotion::ProcessMotion(float gyroX, float gyroY, float gyroZ,
 		AutoCalibration.NoSampleSensorFusion();
 		AutoCalibration.NoSampleStillness();
 	}
-	else if (CurrentCalibrationMode & GamepadMotionHelpers::CalibrationMode::Stillness)
+	else if (CurrentCalibrationMode.Value & GamepadMotionHelpers::CalibrationMode::Stillness)
 	{
-		AutoCalibration.AddSampleStillness(GamepadMotionHelpers::Vec(gyroX, gyroY, gyroZ), GamepadMotionHelpers::Vec(accelX, accelY, accelZ), deltaTime, CurrentCalibrationMode & GamepadMotionHelpers::CalibrationMode::SensorFusion);
+		AutoCalibration.AddSampleStillness(Settings, GamepadMotionHelpers::Vec(gyroX, gyroY, gyroZ), GamepadMotionHelpers::Vec(accelX, accelY, accelZ), deltaTime, CurrentCalibrationMode.Value & GamepadMotionHelpers::CalibrationMode::SensorFusion);
 		AutoCalibration.NoSampleSensorFusion();
 	}
 	else
 	{
 		AutoCalibration.NoSampleStillness();
-		if (CurrentCalibrationMode & GamepadMotionHelpers::CalibrationMode::SensorFusion)
+		if (CurrentCalibrationMode.Value & GamepadMotionHelpers::CalibrationMode::SensorFusion)
 		{
-			AutoCalibration.AddSampleSensorFusion(GamepadMotionHelpers::Vec(gyroX, gyroY, gyroZ), GamepadMotionHelpers::Vec(accelX, accelY, accelZ), deltaTime);
+			AutoCalibration.AddSampleSensorFusion(Settings, GamepadMotionHelpers::Vec(gyroX, gyroY, gyroZ), GamepadMotionHelpers::Vec(accelX, accelY, accelZ), deltaTime);
 		}
 		else
 		{
@@ -1079,7 +1108,7 @@ inline void GamepadMotion::ProcessMotion(float gyroX, float gyroY, float gyroZ,
 	gyroY -= gyroOffsetY;
 	gyroZ -= gyroOffsetZ;
 
-	Motion.Update(gyroX, gyroY, gyroZ, accelX, accelY, accelZ, accelMagnitude, deltaTime);
+	Motion.Update(Settings, gyroX, gyroY, gyroZ, accelX, accelY, accelZ, accelMagnitude, deltaTime);
 
 	Gyro.x = gyroX;
 	Gyro.y = gyroY;
@@ -1090,28 +1119,32 @@ inline void GamepadMotion::ProcessMotion(float gyroX, float gyroY, float gyroZ,
 }
 
 // reading the current state
-inline void GamepadMotion::GetCalibratedGyro(float& x, float& y, float& z)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetCalibratedGyro(float& x, float& y, float& z)
 {
 	x = Gyro.x;
 	y = Gyro.y;
 	z = Gyro.z;
 }
 
-inline void GamepadMotion::GetGravity(float& x, float& y, float& z)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetGravity(float& x, float& y, float& z)
 {
 	x = Motion.Grav.x;
 	y = Motion.Grav.y;
 	z = Motion.Grav.z;
 }
 
-inline void GamepadMotion::GetProcessedAcceleration(float& x, float& y, float& z)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetProcessedAcceleration(float& x, float& y, float& z)
 {
 	x = Motion.Accel.x;
 	y = Motion.Accel.y;
 	z = Motion.Accel.z;
 }
 
-inline void GamepadMotion::GetOrientation(float& w, float& x, float& y, float& z)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetOrientation(float& w, float& x, float& y, float& z)
 {
 	w = Motion.Quaternion.w;
 	x = Motion.Quaternion.x;
@@ -1120,28 +1153,33 @@ inline void GamepadMotion::GetOrientation(float& w, float& x, float& y, float& z
 }
 
 // gyro calibration functions
-inline void GamepadMotion::StartContinuousCalibration()
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::StartContinuousCalibration()
 {
 	IsCalibrating = true;
 }
 
-inline void GamepadMotion::PauseContinuousCalibration()
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::PauseContinuousCalibration()
 {
 	IsCalibrating = false;
 }
 
-inline void GamepadMotion::ResetContinuousCalibration()
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::ResetContinuousCalibration()
 {
 	GyroCalibration = {};
 }
 
-inline void GamepadMotion::GetCalibrationOffset(float& xOffset, float& yOffset, float& zOffset)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetCalibrationOffset(float& xOffset, float& yOffset, float& zOffset)
 {
 	float accelMagnitude;
 	GetCalibratedSensor(xOffset, yOffset, zOffset, accelMagnitude);
 }
 
-inline void GamepadMotion::SetCalibrationOffset(float xOffset, float yOffset, float zOffset, int weight)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::SetCalibrationOffset(float xOffset, float yOffset, float zOffset, int weight)
 {
 	if (GyroCalibration.NumSamples > 1)
 	{
@@ -1158,24 +1196,28 @@ inline void GamepadMotion::SetCalibrationOffset(float xOffset, float yOffset, fl
 	GyroCalibration.Z = zOffset * weight;
 }
 
-inline GamepadMotionHelpers::CalibrationMode GamepadMotion::GetCalibrationMode()
+template<typename SettingsT, typename CalibrationModeT>
+inline GamepadMotionHelpers::CalibrationMode BasicGamepadMotion<SettingsT, CalibrationModeT>::GetCalibrationMode()
 {
-	return CurrentCalibrationMode;
+	return CurrentCalibrationMode.Value;
 }
 
-inline void GamepadMotion::SetCalibrationMode(GamepadMotionHelpers::CalibrationMode calibrationMode)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::SetCalibrationMode(GamepadMotionHelpers::CalibrationMode calibrationMode)
 {
-	CurrentCalibrationMode = calibrationMode;
+	CurrentCalibrationMode.Value = calibrationMode;
 }
 
-inline void GamepadMotion::ResetMotion()
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::ResetMotion()
 {
 	Motion.Reset();
 }
 
 // Private Methods
 
-inline void GamepadMotion::PushSensorSamples(float gyroX, float gyroY, float gyroZ, float accelMagnitude)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::PushSensorSamples(float gyroX, float gyroY, float gyroZ, float accelMagnitude)
 {
 	// accumulate
 	GyroCalibration.NumSamples++;
@@ -1185,7 +1227,8 @@ inline void GamepadMotion::PushSensorSamples(float gyroX, float gyroY, float gyr
 	GyroCalibration.AccelMagnitude += accelMagnitude;
 }
 
-inline void GamepadMotion::GetCalibratedSensor(float& gyroOffsetX, float& gyroOffsetY, float& gyroOffsetZ, float& accelMagnitude)
+template<typename SettingsT, typename CalibrationModeT>
+inline void BasicGamepadMotion<SettingsT, CalibrationModeT>::GetCalibratedSensor(float& gyroOffsetX, float& gyroOffsetY, float& gyroOffsetZ, float& accelMagnitude)
 {
 	if (GyroCalibration.NumSamples <= 0)
 	{
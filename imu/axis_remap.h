@@ -0,0 +1,81 @@
+#ifndef AXIS_REMAP_HEADER
+#define AXIS_REMAP_HEADER
+#include "imu_backend.h"
+
+/*
+Chip axes to device axes, out = m * in, applied to gyro and accel alike.
+Mountings are signed permutations, so each row picks one input axis and
+a sign, specialized per remap that is a move or a negation.
+*/
+struct AxisRemap
+{
+    int8_t m[3][3];
+};
+
+enum AxisRemapId : uint8_t
+{
+    AXIS_REMAP_IDENTITY,
+    AXIS_REMAP_Z90,  // chip rotated 90 degrees counterclockwise on the board
+    AXIS_REMAP_Z180,
+    AXIS_REMAP_Z270,
+    AXIS_REMAP_COUNT,
+};
+
+inline constexpr AxisRemap AXIS_REMAPS[AXIS_REMAP_COUNT] = {
+    {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}},
+    {{{0, -1, 0}, {1, 0, 0}, {0, 0, 1}}},
+    {{{-1, 0, 0}, {0, -1, 0}, {0, 0, 1}}},
+    {{{0, 1, 0}, {-1, 0, 0}, {0, 0, 1}}},
+};
+
+constexpr bool is_signed_permutation(const AxisRemap &remap)
+{
+    int used[3] = {0, 0, 0};
+    for (int row = 0; row < 3; row++)
+    {
+        int nonzero = 0;
+        for (int col = 0; col < 3; col++)
+        {
+            auto value = remap.m[row][col];
+            if (value != 0 && value != 1 && value != -1)
+                return false;
+            if (value != 0)
+            {
+                nonzero++;
+                used[col]++;
+            }
+        }
+        if (nonzero != 1)
+            return false;
+    }
+    return used[0] == 1 && used[1] == 1 && used[2] == 1;
+}
+
+template <AxisRemapId Id, int Row>
+inline float remap_row(const float *in)
+{
+    constexpr auto &row = AXIS_REMAPS[Id].m[Row];
+    constexpr int col = row[0] ? 0 : (row[1] ? 1 : 2);
+    if constexpr (row[col] < 0)
+        return -in[col];
+    else
+        return in[col];
+}
+
+template <AxisRemapId Id>
+inline void remap_reading(ImuReading &reading)
+{
+    static_assert(is_signed_permutation(AXIS_REMAPS[Id]), "axis remap must be a signed permutation");
+    if constexpr (Id == AXIS_REMAP_IDENTITY)
+        return;
+    float gyro[3] = {reading.gyro_x, reading.gyro_y, reading.gyro_z};
+    float accel[3] = {reading.accel_x, reading.accel_y, reading.accel_z};
+    reading.gyro_x = remap_row<Id, 0>(gyro);
+    reading.gyro_y = remap_row<Id, 1>(gyro);
+    reading.gyro_z = remap_row<Id, 2>(gyro);
+    reading.accel_x = remap_row<Id, 0>(accel);
+    reading.accel_y = remap_row<Id, 1>(accel);
+    reading.accel_z = remap_row<Id, 2>(accel);
+}
+
+#endif
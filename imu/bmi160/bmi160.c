@@ -214,6 +214,54 @@ static void default_param_settg(struct bmi160_dev *dev);
  */
 static int8_t null_ptr_check(const struct bmi160_dev *dev);
 
+/*!
+ * @brief This API writes the given data to the sensor without touching
+ * the register shadow.
+ *
+ * @param[in] reg_addr  : Register address to write
+ * @param[in] data      : Pointer to data to be written
+ * @param[in] len       : No of bytes to write
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+static int8_t write_regs(uint8_t reg_addr, const uint8_t *data, uint16_t len, const struct bmi160_dev *dev);
+
+/*!
+ * @brief This API returns the shadow bits covered by a register range,
+ * zero if the range does not overlap the shadow window.
+ *
+ * @param[in] reg_addr  : First register of the range
+ * @param[in] len       : No of registers in the range
+ * @param[out] full     : Set to 1 if the whole range lies in the window
+ *
+ * @return Bit mask of shadow entries
+ */
+static uint64_t shadow_mask(uint8_t reg_addr, uint16_t len, uint8_t *full);
+
+/*!
+ * @brief This API copies the bytes of a bus transfer that overlap the
+ * shadow window into the shadow and marks them valid.
+ *
+ * @param[in] reg_addr  : Register address of the transfer
+ * @param[in] data      : Data read from / written to the sensor
+ * @param[in] len       : No of bytes transferred
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ */
+static void shadow_store(uint8_t reg_addr, const uint8_t *data, uint16_t len, const struct bmi160_dev *dev);
+
+/*!
+ * @brief This API writes out all registers queued in the shadow, one
+ * burst per contiguous run.
+ *
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+static int8_t shadow_flush(const struct bmi160_dev *dev);
+
 /*!
  * @brief This API set the accel configuration.
  *
@@ -1376,6 +1424,8 @@ static int8_t map_feature_interrupt(const struct bmi160_int_settg *int_config, c
 int8_t bmi160_get_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const struct bmi160_dev *dev)
 {
     int8_t rslt = BMI160_OK;
+    uint64_t mask;
+    uint8_t full = 0;
 
     /* Null-pointer check */
     if ((dev == NULL) || (dev->read == NULL))
@@ -1388,13 +1438,37 @@ int8_t bmi160_get_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const stru
     }
     else
     {
+        mask = shadow_mask(reg_addr, len, &full);
+        if ((dev->shadow != NULL) && full && ((mask & BMI160_SHADOW_VOLATILE_MASK) == 0) &&
+            ((dev->shadow->valid & mask) == mask))
+        {
+            /* Served from the shadow, no bus transfer */
+            memcpy(data, &dev->shadow->data[reg_addr - BMI160_SHADOW_START_ADDR], len);
+
+            return BMI160_OK;
+        }
+
+        /* Queued writes have to reach the chip before it is read */
+        rslt = shadow_flush(dev);
+        if (rslt != BMI160_OK)
+        {
+            return rslt;
+        }
+
         /* Configuring reg_addr for SPI Interface */
         if (dev->intf == BMI160_SPI_INTF)
         {
-            reg_addr = (reg_addr | BMI160_SPI_RD_MASK);
+            rslt = dev->read(dev->id, (reg_addr | BMI160_SPI_RD_MASK), data, len);
+        }
+        else
+        {
+            rslt = dev->read(dev->id, reg_addr, data, len);
         }
 
-        rslt = dev->read(dev->id, reg_addr, data, len);
+        if ((rslt == BMI160_OK) && (mask != 0))
+        {
+            shadow_store(reg_addr, data, len, dev);
+        }
     }
 
     return rslt;
@@ -1407,7 +1481,9 @@ int8_t bmi160_get_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const stru
 int8_t bmi160_set_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const struct bmi160_dev *dev)
 {
     int8_t rslt = BMI160_OK;
-    uint8_t count = 0;
+    uint64_t mask;
+    uint8_t full = 0;
+    uint8_t offset;
 
     /* Null-pointer check */
     if ((dev == NULL) || (dev->write == NULL))
@@ -1420,39 +1496,144 @@ int8_t bmi160_set_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const stru
     }
     else
     {
-        /* Configuring reg_addr for SPI Interface */
-        if (dev->intf == BMI160_SPI_INTF)
+        mask = shadow_mask(reg_addr, len, &full);
+        if ((dev->shadow != NULL) && full && ((mask & BMI160_SHADOW_VOLATILE_MASK) == 0))
         {
-            reg_addr = (reg_addr & BMI160_SPI_WR_MASK);
-        }
+            offset = reg_addr - BMI160_SHADOW_START_ADDR;
 
-        if ((dev->prev_accel_cfg.power == BMI160_ACCEL_NORMAL_MODE) ||
-            (dev->prev_gyro_cfg.power == BMI160_GYRO_NORMAL_MODE))
-        {
-            rslt = dev->write(dev->id, reg_addr, data, len);
+            /* Chip already holds these values */
+            if (((dev->shadow->valid & mask) == mask) && (memcmp(&dev->shadow->data[offset], data, len) == 0))
+            {
+                return BMI160_OK;
+            }
 
-            /* Kindly refer bmi160 data sheet section 3.2.4 */
-            dev->delay_ms(1);
+            /* Inside a batch only queue the write */
+            if (dev->shadow->batch)
+            {
+                memcpy(&dev->shadow->data[offset], data, len);
+                dev->shadow->valid |= mask;
+                dev->shadow->dirty |= mask;
 
+                return BMI160_OK;
+            }
         }
-        else
+
+        rslt = shadow_flush(dev);
+        if (rslt == BMI160_OK)
         {
-            /*Burst write is not allowed in
-             * suspend & low power mode */
-            for (; count < len; count++)
-            {
-                rslt = dev->write(dev->id, reg_addr, &data[count], 1);
-                reg_addr++;
+            rslt = write_regs(reg_addr, data, len, dev);
+        }
 
-                /* Kindly refer bmi160 data sheet section 3.2.4 */
-                dev->delay_ms(1);
+        if (dev->shadow != NULL)
+        {
+            if (rslt == BMI160_OK)
+            {
+                shadow_store(reg_addr, data, len, dev);
+            }
+            else
+            {
+                /* State of the chip is unknown after a failed write */
+                dev->shadow->valid &= ~mask;
+            }
 
+            /* Soft reset restores every register to its default */
+            if ((reg_addr == BMI160_COMMAND_REG_ADDR) && (data[0] == BMI160_SOFT_RESET_CMD))
+            {
+                dev->shadow->valid = 0;
+                dev->shadow->dirty = 0;
             }
         }
+    }
 
-        if (rslt != BMI160_OK)
+    return rslt;
+}
+
+/*!
+ * @brief This API starts queueing register writes in the shadow.
+ */
+int8_t bmi160_batch_begin(const struct bmi160_dev *dev)
+{
+    int8_t rslt = BMI160_OK;
+
+    /* Null-pointer check */
+    if (dev == NULL)
+    {
+        rslt = BMI160_E_NULL_PTR;
+    }
+    else if (dev->shadow != NULL)
+    {
+        dev->shadow->batch++;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API writes out the queued registers and stops queueing.
+ */
+int8_t bmi160_batch_end(const struct bmi160_dev *dev)
+{
+    int8_t rslt = BMI160_OK;
+
+    /* Null-pointer check */
+    if (dev == NULL)
+    {
+        rslt = BMI160_E_NULL_PTR;
+    }
+    else if ((dev->shadow != NULL) && (dev->shadow->batch > 0))
+    {
+        dev->shadow->batch--;
+        if (dev->shadow->batch == 0)
         {
-            rslt = BMI160_E_COM_FAIL;
+            rslt = shadow_flush(dev);
+        }
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API writes the shadowed configuration back where the
+ * sensor's registers differ.
+ */
+int8_t bmi160_shadow_restore(const struct bmi160_dev *dev, uint8_t *restored)
+{
+    int8_t rslt = BMI160_OK;
+    uint8_t data[BMI160_SHADOW_LEN];
+    uint8_t idx;
+    uint64_t bit;
+
+    /* Null-pointer check */
+    if ((dev == NULL) || (dev->read == NULL) || (restored == NULL))
+    {
+        rslt = BMI160_E_NULL_PTR;
+    }
+    else
+    {
+        *restored = 0;
+        if (dev->shadow != NULL)
+        {
+            /* Read from the sensor itself, the shadow is what it should be */
+            rslt = dev->read(dev->id, BMI160_SHADOW_START_ADDR, data, BMI160_SHADOW_LEN);
+            if (rslt != BMI160_OK)
+            {
+                rslt = BMI160_E_COM_FAIL;
+            }
+            else
+            {
+                for (idx = 0; idx < BMI160_SHADOW_LEN; idx++)
+                {
+                    bit = UINT64_C(1) << idx;
+                    if ((dev->shadow->valid & bit) && !(BMI160_SHADOW_VOLATILE_MASK & bit) &&
+                        (data[idx] != dev->shadow->data[idx]))
+                    {
+                        dev->shadow->dirty |= bit;
+                        (*restored)++;
+                    }
+                }
+
+                rslt = shadow_flush(dev);
+            }
         }
     }
 
@@ -6432,3 +6613,162 @@ static int8_t trigger_foc(struct bmi160_offsets *offset, struct bmi160_dev const
 
     return rslt;
 }
+
+/*!
+ * @brief This API writes the given data to the sensor without touching
+ * the register shadow.
+ */
+static int8_t write_regs(uint8_t reg_addr, const uint8_t *data, uint16_t len, const struct bmi160_dev *dev)
+{
+    int8_t rslt = BMI160_OK;
+    uint16_t count = 0;
+
+    /* Configuring reg_addr for SPI Interface */
+    if (dev->intf == BMI160_SPI_INTF)
+    {
+        reg_addr = (reg_addr & BMI160_SPI_WR_MASK);
+    }
+
+    if ((dev->prev_accel_cfg.power == BMI160_ACCEL_NORMAL_MODE) ||
+        (dev->prev_gyro_cfg.power == BMI160_GYRO_NORMAL_MODE))
+    {
+        rslt = dev->write(dev->id, reg_addr, (uint8_t *)data, len);
+
+        /* Kindly refer bmi160 data sheet section 3.2.4, in normal mode
+         * only 2us are needed between writes, which the bus already takes.
+         * Commands still get the full delay */
+        if (reg_addr == BMI160_COMMAND_REG_ADDR)
+        {
+            dev->delay_ms(1);
+        }
+    }
+    else
+    {
+        /*Burst write is not allowed in
+         * suspend & low power mode */
+        for (; (count < len) && (rslt == BMI160_OK); count++)
+        {
+            rslt = dev->write(dev->id, reg_addr, (uint8_t *)&data[count], 1);
+            reg_addr++;
+
+            /* Kindly refer bmi160 data sheet section 3.2.4 */
+            dev->delay_ms(1);
+        }
+    }
+
+    if (rslt != BMI160_OK)
+    {
+        rslt = BMI160_E_COM_FAIL;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API returns the shadow bits covered by a register range.
+ */
+static uint64_t shadow_mask(uint8_t reg_addr, uint16_t len, uint8_t *full)
+{
+    uint16_t start = reg_addr;
+    uint16_t end = reg_addr + len;
+    uint16_t win_end = BMI160_SHADOW_START_ADDR + BMI160_SHADOW_LEN;
+    uint64_t mask = 0;
+
+    *full = (start >= BMI160_SHADOW_START_ADDR) && (end <= win_end);
+    if (start < BMI160_SHADOW_START_ADDR)
+    {
+        start = BMI160_SHADOW_START_ADDR;
+    }
+
+    if (end > win_end)
+    {
+        end = win_end;
+    }
+
+    for (; start < end; start++)
+    {
+        mask |= UINT64_C(1) << (start - BMI160_SHADOW_START_ADDR);
+    }
+
+    return mask;
+}
+
+/*!
+ * @brief This API copies the bytes of a bus transfer that overlap the
+ * shadow window into the shadow.
+ */
+static void shadow_store(uint8_t reg_addr, const uint8_t *data, uint16_t len, const struct bmi160_dev *dev)
+{
+    uint16_t addr = reg_addr;
+    uint16_t count;
+    uint8_t offset;
+
+    if (dev->shadow == NULL)
+    {
+        return;
+    }
+
+    for (count = 0; count < len; count++, addr++)
+    {
+        if ((addr < BMI160_SHADOW_START_ADDR) || (addr >= BMI160_SHADOW_START_ADDR + BMI160_SHADOW_LEN))
+        {
+            continue;
+        }
+
+        offset = addr - BMI160_SHADOW_START_ADDR;
+        if (BMI160_SHADOW_VOLATILE_MASK & (UINT64_C(1) << offset))
+        {
+            continue;
+        }
+
+        dev->shadow->data[offset] = data[count];
+        dev->shadow->valid |= UINT64_C(1) << offset;
+    }
+}
+
+/*!
+ * @brief This API writes out all registers queued in the shadow.
+ */
+static int8_t shadow_flush(const struct bmi160_dev *dev)
+{
+    int8_t rslt = BMI160_OK;
+    int8_t run_rslt;
+    uint8_t start = 0;
+    uint8_t end;
+    uint64_t run;
+
+    if ((dev->shadow == NULL) || (dev->shadow->dirty == 0))
+    {
+        return BMI160_OK;
+    }
+
+    while (start < BMI160_SHADOW_LEN)
+    {
+        if (!(dev->shadow->dirty & (UINT64_C(1) << start)))
+        {
+            start++;
+            continue;
+        }
+
+        /* Longest contiguous run of queued registers */
+        end = start;
+        run = 0;
+        while ((end < BMI160_SHADOW_LEN) && (dev->shadow->dirty & (UINT64_C(1) << end)))
+        {
+            run |= UINT64_C(1) << end;
+            end++;
+        }
+
+        dev->shadow->dirty &= ~run;
+        run_rslt = write_regs(BMI160_SHADOW_START_ADDR + start, &dev->shadow->data[start], end - start, dev);
+        if (run_rslt != BMI160_OK)
+        {
+            dev->shadow->valid &= ~run;
+            rslt = run_rslt;
+        }
+
+        start = end;
+    }
+
+    return rslt;
+}
@@ -135,6 +135,64 @@ int8_t bmi160_get_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const stru
  */
 int8_t bmi160_set_regs(uint8_t reg_addr, uint8_t *data, uint16_t len, const struct bmi160_dev *dev);
 
+/*!
+ * \ingroup bmi160ApiRegs
+ * \page bmi160_api_bmi160_batch_begin bmi160_batch_begin
+ * \code
+ * int8_t bmi160_batch_begin(const struct bmi160_dev *dev);
+ * \endcode
+ * @details This API starts queueing writes to the configuration registers
+ * in the register shadow instead of sending them to the sensor. Reads and
+ * writes outside the shadow window still go to the bus and write out the
+ * queue first. Calls may nest. Does nothing if dev->shadow is NULL.
+ *
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ *
+ * @return Result of API execution status
+ * @retval Zero Success
+ * @retval Negative Error
+ */
+int8_t bmi160_batch_begin(const struct bmi160_dev *dev);
+
+/*!
+ * \ingroup bmi160ApiRegs
+ * \page bmi160_api_bmi160_batch_end bmi160_batch_end
+ * \code
+ * int8_t bmi160_batch_end(const struct bmi160_dev *dev);
+ * \endcode
+ * @details This API ends a batch started by bmi160_batch_begin. The
+ * outermost call writes out the queued registers, one burst per contiguous
+ * run in ascending address order.
+ *
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ *
+ * @return Result of API execution status
+ * @retval Zero Success
+ * @retval Negative Error
+ */
+int8_t bmi160_batch_end(const struct bmi160_dev *dev);
+
+/*!
+ * \ingroup bmi160ApiRegs
+ * \page bmi160_api_bmi160_shadow_restore bmi160_shadow_restore
+ * \code
+ * int8_t bmi160_shadow_restore(const struct bmi160_dev *dev, uint8_t *restored);
+ * \endcode
+ * @details This API reads the configuration registers back from the
+ * sensor, bypassing the shadow, and writes the shadowed value to every
+ * register that differs, e.g. after the sensor lost power. Registers
+ * never written and the volatile ones (offsets, self test) are left
+ * alone. Does nothing if dev->shadow is NULL.
+ *
+ * @param[in] dev       : Structure instance of bmi160_dev.
+ * @param[out] restored : No of registers written back
+ *
+ * @return Result of API execution status
+ * @retval Zero Success
+ * @retval Negative Error
+ */
+int8_t bmi160_shadow_restore(const struct bmi160_dev *dev, uint8_t *restored);
+
 /**
  * \ingroup bmi160
  * \defgroup bmi160ApiSoftreset Soft reset
@@ -364,6 +364,14 @@
 #define BMI160_SOFT_RESET_CMD                     UINT8_C(0xb6)
 #define BMI160_SOFT_RESET_DELAY_MS                UINT8_C(1)
 
+/** Register shadow window, covers the configuration block 0x40 - 0x7D */
+#define BMI160_SHADOW_START_ADDR                  UINT8_C(0x40)
+#define BMI160_SHADOW_LEN                         UINT8_C(0x3E)
+
+/** Shadow offsets the chip changes on its own (self test, FOC offsets,
+ * step counter), these are never served from the shadow */
+#define BMI160_SHADOW_VOLATILE_MASK               ((UINT64_C(1) << 0x2D) | (UINT64_C(0x1FF) << 0x31))
+
 /** Start FOC command */
 #define BMI160_START_FOC_CMD                      UINT8_C(0x03)
 
@@ -1595,6 +1603,24 @@ struct bmi160_fifo_frame
     /*! Value of Skipped frame counts */
     uint8_t skipped_frame_count;
 };
+/*!
+ * @brief Write-through shadow of the configuration registers
+ */
+struct bmi160_reg_shadow
+{
+    /*! Last value written to / read from each register */
+    uint8_t data[BMI160_SHADOW_LEN];
+
+    /*! Bit n set - data[n] matches the chip */
+    uint64_t valid;
+
+    /*! Bit n set - data[n] is queued and not yet written */
+    uint64_t dirty;
+
+    /*! Non-zero between bmi160_batch_begin and bmi160_batch_end */
+    uint8_t batch;
+};
+
 struct bmi160_dev
 {
     /*! Chip Id */
@@ -1649,6 +1675,9 @@ struct bmi160_dev
 
     /*! User set read/write length */
     uint16_t read_write_len;
+
+    /*! Optional register shadow, NULL disables caching */
+    struct bmi160_reg_shadow *shadow;
 };
 
 #endif /* BMI160_DEFS_H_ */
@@ -0,0 +1,446 @@
+#include "bmi160_backend.h"
+#include <math.h>
+#include <stdio.h>
+#include <iostream>
+
+float lsb_to_ms2(int16_t val, float g_range, uint8_t bit_width)
+{
+    float half_scale = (float)(1 << bit_width) / 2.0f;
+
+    return GRAVITY_EARTH * val * g_range / half_scale;
+}
+float lsb_to_mg(int16_t val, float g_range, uint8_t bit_width)
+{
+    float half_scale = (float)(1 << bit_width) / 2.0f;
+
+    return 1000.0f * val * g_range / half_scale;
+}
+
+float lsb_to_dps(int16_t val, float g_range, uint8_t bit_width)
+{
+    float half_scale = (float)(1 << bit_width) / 2.0f;
+
+    return val * g_range / half_scale;
+}
+
+// adapter of the Bosch API callbacks, they only get the address
+static I2cBus *i2c_bus = nullptr;
+
+/*
+the Bosch API checks these results, a failed transfer is BMI160_E_COM_FAIL.
+Every call is one burst on the backend's open client, so a run the shadow
+coalesced is one bus transfer
+*/
+int8_t read_reg(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+    if (i2c_bus == nullptr || !i2c_bus->read(reg_addr, data, len))
+        return BMI160_E_COM_FAIL;
+    return BMI160_OK;
+};
+
+int8_t write_reg(uint8_t dev_addr, uint8_t reg_addr, uint8_t *read_data, uint16_t len)
+{
+    if (i2c_bus == nullptr || !i2c_bus->writeRegs(reg_addr, read_data, len))
+        return BMI160_E_COM_FAIL;
+    return BMI160_OK;
+};
+
+void delay_ms(uint32_t period)
+{
+    // sleep(0.01*period);
+    usleep(1000 * period);
+}
+
+Bmi160Backend::Bmi160Backend(const std::string &bus_path, uint8_t addr)
+{
+    sensor = new bmi160_dev();
+
+    // the Bosch API reaches the chip through this client too
+    opened = bus.open(bus_path.c_str(), addr);
+    if (!opened)
+        return;
+    i2c_bus = &bus;
+
+    // init IMU
+    sensor->id = addr;
+    sensor->intf = BMI160_I2C_INTF;
+    sensor->read = read_reg;
+    sensor->write = write_reg;
+    sensor->delay_ms = (bmi160_delay_fptr_t)delay_ms;
+    // config registers are cached, every read-modify-write costs one bus write
+    sensor->shadow = new bmi160_reg_shadow();
+    // Fast offset compensation, kept to restore the offsets after a reset
+    foc_conf.acc_off_en = BMI160_ENABLE;
+    foc_conf.gyro_off_en = BMI160_ENABLE;
+    foc_conf.foc_acc_x = BMI160_FOC_ACCEL_NEGATIVE_G;
+    foc_conf.foc_acc_y = BMI160_FOC_ACCEL_0G;
+    foc_conf.foc_acc_z = BMI160_FOC_ACCEL_0G;
+    foc_conf.foc_gyr_en = BMI160_ENABLE;
+
+    // a chip left configured by an earlier run skips reset, power-up and FOC
+    bool warm = warmAttach();
+    if (!warm)
+    {
+        // a chip id mismatch is only reported, compatible chips still run
+        auto ret = bmi160_init(sensor);
+        if (ret != BMI160_OK)
+            std::cout << "bmi160 init err! " << +ret << std::endl;
+    }
+
+    // power on, only written if the chip is not on already
+    sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
+    sensor->gyro_cfg.power = BMI160_GYRO_NORMAL_MODE;
+    bmi160_set_power_mode(sensor);
+    if (warm)
+        std::cout << "bmi160 warm attach" << std::endl;
+    else
+    {
+        sleep(1);
+        auto foc_status = bmi160_start_foc(&foc_conf, &offsets, sensor);
+        if (foc_status != BMI160_OK)
+            std::cout << "bmi160 foc err! " << +foc_status << std::endl;
+        else
+            bmi160_set_offsets(&foc_conf, &offsets, sensor);
+    }
+
+    // g_ratio = g_ratio_table[sensor->accel_cfg.range];
+    // dps_ratio = dps_ratio_table[sensor->gyro_cfg.range];
+
+    // std::cout << "g ratio: " << g_ratio
+    //           << " dps ratio: " << dps_ratio << std::endl;
+
+    // set device
+    // /* Select the Output data rate, range of accelerometer sensor */
+    // sensor->accel_cfg.odr = BMI160_ACCEL_ODR_1600HZ;
+    // sensor->accel_cfg.range = BMI160_ACCEL_RANGE_16G;
+    // sensor->accel_cfg.bw = BMI160_ACCEL_BW_NORMAL_AVG4;
+
+    // /* Select the power mode of accelerometer sensor */
+    // sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
+
+    // /* Select the Output data rate, range of Gyroscope sensor */
+    // sensor->gyro_cfg.odr = BMI160_GYRO_ODR_3200HZ;
+    // sensor->gyro_cfg.range = BMI160_GYRO_RANGE_2000_DPS;
+    // sensor->gyro_cfg.bw = BMI160_GYRO_BW_NORMAL_MODE;
+
+    // /* Select the power mode of Gyroscope sensor */
+    // sensor->gyro_cfg.power = BMI160_GYRO_NORMAL_MODE;
+    // /* Set the sensor configuration */
+    // auto rslt = bmi160_set_sens_conf(sensor);
+    // std::cout << "set conf ret: " << +rslt << std::endl;
+    g_ratio = g_ratio_table[sensor->accel_cfg.range];
+    dps_ratio = dps_ratio_table[sensor->gyro_cfg.range];
+
+    std::cout << "g ratio: " << g_ratio
+              << " dps ratio: " << dps_ratio << std::endl;
+
+    period = std::chrono::microseconds(static_cast<int>(10000 * pow(2, BMI160_GYRO_ODR_100HZ - sensor->gyro_cfg.odr)));
+    next = std::chrono::steady_clock::now();
+
+    // stays powered only until the sampling thread sees there is no demand
+    setupMotionInterrupts();
+    // let the IMU finish self-calib
+    if (!warm)
+        sleep(1);
+};
+
+Bmi160Backend::~Bmi160Backend()
+{
+    if (i2c_bus == &bus)
+        i2c_bus = nullptr;
+}
+
+/*
+take over a chip an earlier run or a suspend left behind, without a
+reset: it has to have the rates and ranges a cold start leaves and the
+FOC offsets applied. The whole config window is read into the shadow on
+the way, so the power mode and interrupt setup after it only write what
+differs. The power mode read back becomes the previous one.
+*/
+bool Bmi160Backend::warmAttach()
+{
+    uint8_t window[BMI160_SHADOW_LEN];
+    uint8_t offset_conf = 0;
+    if (bmi160_get_regs(BMI160_CHIP_ID_ADDR, &sensor->chip_id, 1, sensor) != BMI160_OK ||
+        sensor->chip_id != BMI160_CHIP_ID ||
+        bmi160_get_regs(BMI160_SHADOW_START_ADDR, window, BMI160_SHADOW_LEN, sensor) != BMI160_OK ||
+        bmi160_get_sens_conf(sensor) != BMI160_OK ||
+        bmi160_get_power_mode(sensor) != BMI160_OK ||
+        bmi160_get_regs(BMI160_OFFSET_CONF_ADDR, &offset_conf, 1, sensor) != BMI160_OK ||
+        bmi160_get_offsets(&offsets, sensor) != BMI160_OK)
+        return false;
+    sensor->any_sig_sel = BMI160_BOTH_ANY_SIG_MOTION_DISABLED;
+    // PMU_STATUS only has the low bits of the power mode commands
+    sensor->accel_cfg.power |= BMI160_ACCEL_SUSPEND_MODE;
+    sensor->gyro_cfg.power |= BMI160_GYRO_SUSPEND_MODE;
+    sensor->prev_accel_cfg = sensor->accel_cfg;
+    sensor->prev_gyro_cfg = sensor->gyro_cfg;
+    return sensor->accel_cfg.odr == BMI160_ACCEL_ODR_100HZ &&
+           sensor->accel_cfg.range == BMI160_ACCEL_RANGE_2G &&
+           sensor->accel_cfg.bw == BMI160_ACCEL_BW_NORMAL_AVG4 &&
+           sensor->gyro_cfg.odr == BMI160_GYRO_ODR_100HZ &&
+           sensor->gyro_cfg.range == BMI160_GYRO_RANGE_2000_DPS &&
+           sensor->gyro_cfg.bw == BMI160_GYRO_BW_NORMAL_MODE &&
+           (offset_conf & BMI160_OFFSET_EN_MASK) == BMI160_OFFSET_EN_MASK;
+}
+
+/*
+any-motion and no-motion on the accel slope plus the gestures: tap,
+double tap, high-g, orientation and flat. Mapped to INT1 with the pin
+output disabled, they are only read back from INT_STATUS, with the
+samples or by the motion polls. The status is held for IMU_INT_LATCH,
+fully latched interrupts would need a reset that also restarts the tap
+detection between the two taps of a double tap.
+*/
+void Bmi160Backend::setupMotionInterrupts()
+{
+    bmi160_int_settg int_config = {};
+    int_config.int_channel = BMI160_INT_CHANNEL_1;
+    int_config.int_pin_settg.output_en = BMI160_DISABLE;
+    int_config.int_pin_settg.latch_dur = IMU_INT_LATCH;
+    // the interrupts share INT_EN/INT_MAP/INT_MOTION, write them out once
+    bmi160_batch_begin(sensor);
+
+    int_config.int_type = BMI160_ACC_ANY_MOTION_INT;
+    auto &any_motion = int_config.int_type_cfg.acc_any_motion_int;
+    any_motion.anymotion_en = BMI160_ENABLE;
+    any_motion.anymotion_x = BMI160_ENABLE;
+    any_motion.anymotion_y = BMI160_ENABLE;
+    any_motion.anymotion_z = BMI160_ENABLE;
+    any_motion.anymotion_dur = 0;
+    any_motion.anymotion_thr = IMU_ANY_MOTION_THRESHOLD;
+    if (bmi160_set_int_config(&int_config, sensor) != BMI160_OK)
+        std::cout << "any-motion int err!" << std::endl;
+
+    int_config.int_type = BMI160_ACC_SLOW_NO_MOTION_INT;
+    auto &no_motion = int_config.int_type_cfg.acc_no_motion_int;
+    no_motion.no_motion_x = BMI160_ENABLE;
+    no_motion.no_motion_y = BMI160_ENABLE;
+    no_motion.no_motion_z = BMI160_ENABLE;
+    no_motion.no_motion_dur = IMU_NO_MOTION_DURATION;
+    no_motion.no_motion_sel = BMI160_ENABLE;
+    no_motion.no_motion_thres = IMU_NO_MOTION_THRESHOLD;
+    if (bmi160_set_int_config(&int_config, sensor) != BMI160_OK)
+        std::cout << "no-motion int err!" << std::endl;
+
+    int_config.int_type_cfg.acc_tap_int = {};
+    auto &tap = int_config.int_type_cfg.acc_tap_int;
+    tap.tap_en = BMI160_ENABLE;
+    tap.tap_data_src = 1;
+    tap.tap_thr = IMU_TAP_THRESHOLD;
+    tap.tap_dur = IMU_TAP_DOUBLE_WINDOW;
+    int_config.int_type = BMI160_ACC_SINGLE_TAP_INT;
+    bool gestures_ok = bmi160_set_int_config(&int_config, sensor) == BMI160_OK;
+    int_config.int_type = BMI160_ACC_DOUBLE_TAP_INT;
+    gestures_ok &= bmi160_set_int_config(&int_config, sensor) == BMI160_OK;
+
+    int_config.int_type = BMI160_ACC_HIGH_G_INT;
+    int_config.int_type_cfg.acc_high_g_int = {};
+    auto &high_g = int_config.int_type_cfg.acc_high_g_int;
+    high_g.high_g_x = BMI160_ENABLE;
+    high_g.high_g_y = BMI160_ENABLE;
+    high_g.high_g_z = BMI160_ENABLE;
+    high_g.high_hy = 1;
+    high_g.high_thres = IMU_HIGH_G_THRESHOLD;
+    high_g.high_dur = IMU_HIGH_G_DURATION;
+    gestures_ok &= bmi160_set_int_config(&int_config, sensor) == BMI160_OK;
+
+    int_config.int_type = BMI160_ACC_ORIENT_INT;
+    int_config.int_type_cfg.acc_orient_int = {};
+    auto &orient = int_config.int_type_cfg.acc_orient_int;
+    orient.orient_en = BMI160_ENABLE;
+    orient.orient_ud_en = BMI160_ENABLE;
+    orient.orient_blocking = 1;
+    orient.orient_hyst = 1;
+    orient.orient_theta = IMU_ORIENT_THETA;
+    gestures_ok &= bmi160_set_int_config(&int_config, sensor) == BMI160_OK;
+
+    int_config.int_type = BMI160_ACC_FLAT_INT;
+    int_config.int_type_cfg.acc_flat_int = {};
+    auto &flat = int_config.int_type_cfg.acc_flat_int;
+    flat.flat_en = BMI160_ENABLE;
+    flat.flat_theta = IMU_FLAT_THETA;
+    flat.flat_hy = 1;
+    flat.flat_hold_time = IMU_FLAT_HOLD_TIME;
+    gestures_ok &= bmi160_set_int_config(&int_config, sensor) == BMI160_OK;
+    if (!gestures_ok)
+        std::cout << "gesture int err!" << std::endl;
+    if (bmi160_batch_end(sensor) != BMI160_OK)
+        std::cout << "motion int write err!" << std::endl;
+}
+
+/*
+all of INT_STATUS, gestures are picked up on the way
+*/
+uint8_t Bmi160Backend::readIntStatus(uint8_t index)
+{
+    uint8_t status[BMI160_INT_STATUS_LEN] = {};
+    if (bmi160_get_regs(BMI160_INT_STATUS_ADDR, status, BMI160_INT_STATUS_LEN, sensor) == BMI160_OK)
+        collectGestures(status);
+    return status[index];
+}
+
+/*
+off: both sensors suspended. idle: gyro in fast start-up, which resumes
+in ~10ms instead of ~80ms from suspend. The held interrupts are cleared
+on every change so only new events count.
+*/
+void Bmi160Backend::setPowerState(PowerState state)
+{
+    switch (state)
+    {
+    case POWER_OFF:
+        sensor->accel_cfg.power = BMI160_ACCEL_SUSPEND_MODE;
+        sensor->gyro_cfg.power = BMI160_GYRO_SUSPEND_MODE;
+        break;
+    case POWER_IDLE:
+        sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
+        sensor->gyro_cfg.power = BMI160_GYRO_FASTSTARTUP_MODE;
+        break;
+    case POWER_ACTIVE:
+        sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
+        sensor->gyro_cfg.power = BMI160_GYRO_NORMAL_MODE;
+        break;
+    }
+    if (bmi160_set_power_mode(sensor) != BMI160_OK)
+        std::cout << "imu power mode err!" << std::endl;
+    uint8_t cmd = BMI160_INT_RESET_CMD;
+    bmi160_set_regs(BMI160_COMMAND_REG_ADDR, &cmd, 1, sensor);
+    // sensortime moved on unread meanwhile, after a few minutes far
+    // enough to look like a reset, the next reading is a new base
+    if (state == POWER_ACTIVE)
+        has_sensortime = false;
+    next = std::chrono::steady_clock::now();
+}
+
+/*
+a fresh bus client, then every config register that differs from the
+shadow is written back. A chip that lost power is back in suspend with
+its offsets cleared, it is powered up first and gets the offsets from the
+start-up FOC, the gyro's start-up time then dominates the outage.
+*/
+bool Bmi160Backend::recover()
+{
+    if (!bus.reopen())
+    {
+        health.bus_errors++;
+        return false;
+    }
+    uint8_t pmu_status = 0;
+    if (bmi160_get_regs(BMI160_PMU_STATUS_ADDR, &pmu_status, 1, sensor) != BMI160_OK)
+    {
+        health.bus_errors++;
+        return false;
+    }
+    // the driver only spaces out writes the way suspend needs while it
+    // knows the chip is suspended, so power comes back before the config
+    uint8_t expected = (sensor->accel_cfg.power & 0x03) << 4 | (sensor->gyro_cfg.power & 0x03) << 2;
+    bool powered = (pmu_status & BMI160_PMU_STATUS_MASK) == expected;
+    if (!powered)
+    {
+        sensor->prev_accel_cfg.power = BMI160_ACCEL_SUSPEND_MODE;
+        sensor->prev_gyro_cfg.power = BMI160_GYRO_SUSPEND_MODE;
+        if (bmi160_set_power_mode(sensor) != BMI160_OK)
+            return false;
+    }
+    uint8_t restored = 0;
+    if (bmi160_shadow_restore(sensor, &restored) != BMI160_OK)
+    {
+        health.bus_errors++;
+        return false;
+    }
+    if ((restored > 0 || !powered) && bmi160_set_offsets(&foc_conf, &offsets, sensor) != BMI160_OK)
+        return false;
+    if (restored > 0 || !powered)
+        std::cout << "bmi160 recovered " << +restored << " registers" << (powered ? "" : " and power") << std::endl;
+    has_sensortime = false;
+    next = std::chrono::steady_clock::now();
+    return true;
+}
+
+/*
+both sensors at 800Hz into the FIFO until max readings are in, read in
+bursts through the FIFO data register, which does not increment. The
+rates and the FIFO are set back afterwards, the shadow keeps the writes
+down to the registers that change.
+*/
+size_t Bmi160Backend::captureBurst(ImuReading *readings, size_t max)
+{
+    auto accel_odr = sensor->accel_cfg.odr;
+    auto gyro_odr = sensor->gyro_cfg.odr;
+    uint8_t fifo_config = BMI160_BURST_FIFO_CONFIG;
+    uint8_t cmd = BMI160_FIFO_FLUSH_VALUE;
+    sensor->accel_cfg.odr = BMI160_ACCEL_ODR_800HZ;
+    sensor->gyro_cfg.odr = BMI160_GYRO_ODR_800HZ;
+    size_t count = 0;
+    if (bmi160_set_sens_conf(sensor) == BMI160_OK &&
+        bmi160_set_regs(BMI160_FIFO_CONFIG_1_ADDR, &fifo_config, 1, sensor) == BMI160_OK &&
+        bmi160_set_regs(BMI160_COMMAND_REG_ADDR, &cmd, 1, sensor) == BMI160_OK)
+    {
+        decoder.configure(g_ratio, dps_ratio, BMI160_GYRO_ODR_800HZ);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(BMI160_BURST_TIMEOUT_MS);
+        while (count < max && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(BMI160_BURST_POLL_MS));
+            uint8_t length[2];
+            if (!bus.read(BMI160_FIFO_LENGTH_ADDR, length, 2))
+            {
+                health.bus_errors++;
+                break;
+            }
+            // whole frames only when the rest does not fit, the sensortime
+            // frame is only there once the FIFO is read empty. The length
+            // field goes up to 2047, a garbled one must not overrun fifo
+            size_t len = length[0] | (length[1] & 0x07) << 8;
+            size_t frames = std::min<size_t>({max - count, FIFO_BLOCK_MAX, FIFO_SIZE / BMI160_FIFO_FRAME_LEN});
+            size_t cap = frames * BMI160_FIFO_FRAME_LEN;
+            len = len <= cap ? len + BMI160_FIFO_SENSORTIME_LEN : cap;
+            if (!bus.readFifo(BMI160_FIFO_DATA_ADDR, fifo, len))
+            {
+                health.bus_errors++;
+                break;
+            }
+            decoder.decode(fifo, len, block);
+            health.overflows += block.overflows;
+            for (size_t k = 0; k < block.count && count < max; k++)
+            {
+                uint32_t step = (block.sensortime[k] - sensortime) & SENSORTIME_MASK;
+                if (has_sensortime && step == 0)
+                    continue;
+                if (has_sensortime)
+                    ticks += step;
+                sensortime = block.sensortime[k];
+                has_sensortime = true;
+
+                auto &reading = readings[count++];
+                reading.timestamp = sensortime_ns(ticks);
+                reading.gyro_x = block.gyro_x[k];
+                reading.gyro_y = block.gyro_y[k];
+                reading.gyro_z = block.gyro_z[k];
+                reading.accel_x = block.accel_x[k];
+                reading.accel_y = block.accel_y[k];
+                reading.accel_z = block.accel_z[k];
+            }
+        }
+    }
+    else
+        std::cout << "bmi160 burst setup err!" << std::endl;
+
+    fifo_config = 0;
+    sensor->accel_cfg.odr = accel_odr;
+    sensor->gyro_cfg.odr = gyro_odr;
+    if (bmi160_set_sens_conf(sensor) != BMI160_OK ||
+        bmi160_set_regs(BMI160_FIFO_CONFIG_1_ADDR, &fifo_config, 1, sensor) != BMI160_OK)
+        std::cout << "bmi160 burst restore err!" << std::endl;
+    next = std::chrono::steady_clock::now();
+    return count;
+}
+
+/* the temperature comes with the last sample read, no bus access here */
+bool Bmi160Backend::readTemperature(float &celsius)
+{
+    if (temperature == INT16_MIN)
+        return false;
+    celsius = 23 + temperature / 512.0f;
+    return true;
+}
@@ -0,0 +1,192 @@
+#ifndef BMI160_BACKEND_HEADER
+#define BMI160_BACKEND_HEADER
+#include "imu_backend.h"
+#include "i2c_bus.h"
+#include "fifo_decoder.h"
+#include "bmi160/bmi160.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+
+// gyro, accel, sensortime, the interrupt status and the die temperature
+// in one read, 0x0C..0x21
+#define BMI160_SAMPLE_ADDR (0x0C)
+#define BMI160_SAMPLE_LEN (22)
+#define BMI160_SAMPLE_INT_STATUS (BMI160_INT_STATUS_ADDR - BMI160_SAMPLE_ADDR)
+#define BMI160_INT_STATUS_LEN (4)
+// die temperature, 0 is 23 degC with 1/512 degC per lsb, 0x8000 if invalid
+#define BMI160_SAMPLE_TEMPERATURE (0x20 - BMI160_SAMPLE_ADDR)
+// slope thresholds in 3.91mg steps (2g range), no-motion after ~5s still
+#define IMU_ANY_MOTION_THRESHOLD (20)
+#define IMU_NO_MOTION_THRESHOLD (10)
+#define IMU_NO_MOTION_DURATION (3)
+// interrupt status 0 bit 2, interrupt status 1 bit 7
+#define IMU_INT_STATUS_ANY_MOTION (0x04)
+#define IMU_INT_STATUS_NO_MOTION (0x80)
+// interrupts stay set this long, longer than the idle poll, so every
+// gesture is seen while its status is set
+#define IMU_INT_LATCH (BMI160_LATCH_DUR_160_MILLI_SEC)
+// tap above 500mg (62.5mg steps) on the unfiltered data, a second tap
+// within 250ms is a double tap
+#define IMU_TAP_THRESHOLD (8)
+#define IMU_TAP_DOUBLE_WINDOW (4)
+// high-g above 1.5g (7.81mg steps) for 15ms ((dur + 1) * 2.5ms)
+#define IMU_HIGH_G_THRESHOLD (192)
+#define IMU_HIGH_G_DURATION (5)
+// orientation changes are blocked within 8 * 0.7 deg of flat
+#define IMU_ORIENT_THETA (8)
+// flat at the chip's default angle, held for 640ms
+#define IMU_FLAT_THETA (8)
+#define IMU_FLAT_HOLD_TIME (1)
+// interrupt status 0: double tap, single tap, orientation and flat,
+// status 1: high-g, status 3: the current flat state
+#define IMU_INT_STATUS_DOUBLE_TAP (0x10)
+#define IMU_INT_STATUS_TAP (0x20)
+#define IMU_INT_STATUS_ORIENTATION (0x40)
+#define IMU_INT_STATUS_FLAT (0x80)
+#define IMU_INT_STATUS_HIGH_G (0x04)
+#define IMU_INT_STATUS_IS_FLAT (0x80)
+#define BMI160_INT_RESET_CMD (0xB1)
+// PMU_STATUS: accel mode in bits 5..4, gyro mode in bits 3..2
+#define BMI160_PMU_STATUS_MASK (0x3C)
+// OFFSET_6, set once the FOC offsets are applied
+#define BMI160_OFFSET_EN_MASK (BMI160_GYRO_OFFSET_EN_MSK | BMI160_ACCEL_OFFSET_EN_MSK)
+// a sensortime step this large is the counter starting over
+#define BMI160_SENSORTIME_RESET (SENSORTIME_MASK / 2)
+// burst capture: both sensors at 800Hz into the header mode FIFO, drained
+// every 40ms (32 frames of the 78 that fit), given up after 1s
+#define BMI160_BURST_FIFO_CONFIG (BMI160_FIFO_GYRO | BMI160_FIFO_ACCEL | BMI160_FIFO_HEADER | BMI160_FIFO_TIME)
+#define BMI160_BURST_POLL_MS (40)
+#define BMI160_BURST_TIMEOUT_MS (1000)
+#define BMI160_FIFO_FRAME_LEN (13)
+#define BMI160_FIFO_SENSORTIME_LEN (4)
+
+/*
+BMI160 driven from userspace over i2c-dev. Setup goes through the
+Bosch API, samples are polled with one direct read of the data
+registers at the gyro output data rate.
+*/
+class Bmi160Backend
+{
+private:
+    float g_ratio_table[13] = {0, 0, 0, 16384, 0, 8192, 0, 0, 2096, 0, 0, 0, 2048};
+    float dps_ratio_table[5] = {16.4, 32.8, 65.6, 131.2, 262.4};
+    bmi160_dev *sensor;
+    bmi160_foc_conf foc_conf = {};
+    bmi160_offsets offsets = {};
+    I2cBus bus;
+    bool opened = false;
+    float g_ratio, dps_ratio;
+
+    std::chrono::microseconds period{10000};
+    std::chrono::steady_clock::time_point next;
+    // sensortime with its wraps counted
+    uint32_t sensortime = 0;
+    int64_t ticks = 0;
+    bool has_sensortime = false;
+    BackendHealth health;
+    FifoDecoder decoder;
+    FifoBlock block;
+    uint8_t fifo[FIFO_SIZE + BMI160_FIFO_SENSORTIME_LEN];
+    // gesture bits set in the last status read, and new ones not taken yet
+    uint32_t gesture_state = 0;
+    uint32_t new_gestures = 0;
+    // raw die temperature from the last sample read
+    int16_t temperature = INT16_MIN;
+
+    bool warmAttach();
+    void setupMotionInterrupts();
+    uint8_t readIntStatus(uint8_t index);
+
+    /*
+    a gesture's status stays set for the latch time, only its rising edge
+    counts
+    */
+    inline void collectGestures(const uint8_t *status)
+    {
+        uint32_t state = 0;
+        if (status[0] & IMU_INT_STATUS_TAP)
+            state |= IMU_GESTURE_TAP;
+        if (status[0] & IMU_INT_STATUS_DOUBLE_TAP)
+            state |= IMU_GESTURE_DOUBLE_TAP;
+        if (status[1] & IMU_INT_STATUS_HIGH_G)
+            state |= IMU_GESTURE_HIGH_G;
+        if (status[0] & IMU_INT_STATUS_ORIENTATION)
+            state |= IMU_GESTURE_ORIENTATION;
+        // the flat interrupt is also raised when it is picked up again
+        if ((status[0] & IMU_INT_STATUS_FLAT) && (status[3] & IMU_INT_STATUS_IS_FLAT))
+            state |= IMU_GESTURE_FLAT;
+        new_gestures |= state & ~gesture_state;
+        gesture_state = state;
+    }
+
+public:
+    static constexpr bool has_motion_interrupts = true;
+    static constexpr bool has_burst_capture = true;
+    static constexpr bool has_gestures = true;
+
+    Bmi160Backend(const std::string &bus_path = I2C_BUS_PATH, uint8_t addr = BMI160_I2C_ADDR);
+    Bmi160Backend(const Bmi160Backend &) = delete;
+    ~Bmi160Backend();
+    bool isOpen() const { return opened; };
+    int getSamplePeriodUs() const { return period.count(); };
+    void setPowerState(PowerState state);
+    bool readTemperature(float &celsius);
+    bool anyMotion() { return readIntStatus(0) & IMU_INT_STATUS_ANY_MOTION; };
+    bool noMotion() { return readIntStatus(1) & IMU_INT_STATUS_NO_MOTION; };
+    const BackendHealth &getHealth() const { return health; };
+    bool recover();
+    size_t captureBurst(ImuReading *readings, size_t max);
+    uint32_t gestures() { return std::exchange(new_gestures, 0); };
+
+    /*
+    one reading per output data period, none if sensortime did not move
+    */
+    inline size_t read(ImuReading *readings, size_t max)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+        uint8_t data[BMI160_SAMPLE_LEN];
+        if (max == 0)
+            return 0;
+        if (!bus.read(BMI160_SAMPLE_ADDR, data, BMI160_SAMPLE_LEN))
+        {
+            health.bus_errors++;
+            return 0;
+        }
+        collectGestures(data + BMI160_SAMPLE_INT_STATUS);
+        temperature = static_cast<int16_t>(data[BMI160_SAMPLE_TEMPERATURE] | data[BMI160_SAMPLE_TEMPERATURE + 1] << 8);
+        uint32_t now = data[12] | data[13] << 8 | data[14] << 16;
+        // sensortime wraps every ~650s
+        uint32_t step = (now - sensortime) & SENSORTIME_MASK;
+        if (has_sensortime && step == 0)
+        {
+            health.stalls++;
+            return 0;
+        }
+        if (has_sensortime && step > BMI160_SENSORTIME_RESET)
+        {
+            // the chip was reset, the next reading starts the clock again
+            health.resets++;
+            has_sensortime = false;
+            return 0;
+        }
+        if (has_sensortime)
+            ticks += step;
+        sensortime = now;
+        has_sensortime = true;
+
+        auto &reading = readings[0];
+        reading.timestamp = sensortime_ns(ticks);
+        reading.gyro_x = static_cast<int16_t>(data[0] | data[1] << 8) / dps_ratio;
+        reading.gyro_y = static_cast<int16_t>(data[2] | data[3] << 8) / dps_ratio;
+        reading.gyro_z = static_cast<int16_t>(data[4] | data[5] << 8) / dps_ratio;
+        reading.accel_x = static_cast<int16_t>(data[6] | data[7] << 8) / g_ratio;
+        reading.accel_y = static_cast<int16_t>(data[8] | data[9] << 8) / g_ratio;
+        reading.accel_z = static_cast<int16_t>(data[10] | data[11] << 8) / g_ratio;
+        return 1;
+    }
+};
+
+#endif
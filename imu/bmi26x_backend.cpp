@@ -0,0 +1,23 @@
+#include "bmi26x_backend.h"
+#include <fstream>
+#include <iterator>
+
+/*
+without a path the file the kernel driver would load for the chip, the
+size is checked, the content is Bosch's and not validated
+*/
+std::vector<uint8_t> bmi26x_load_config(const std::string &path, uint8_t chip_id)
+{
+    auto file_path = path;
+    if (file_path.empty())
+        file_path = std::string(BMI26X_FIRMWARE_DIR) +
+                    (chip_id == BMI270_CHIP_ID ? BMI270_CONFIG_FILE : BMI260_CONFIG_FILE);
+    std::ifstream file(file_path, std::ios::binary);
+    std::vector<uint8_t> config((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (config.size() != BMI26X_CONFIG_SIZE)
+    {
+        std::cout << "bmi26x config file err! " << file_path << std::endl;
+        config.clear();
+    }
+    return config;
+}
@@ -0,0 +1,412 @@
+#ifndef BMI26X_BACKEND_HEADER
+#define BMI26X_BACKEND_HEADER
+#include "imu_backend.h"
+#include "i2c_bus.h"
+#include "fifo_decoder.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BMI26X_I2C_ADDR (0x68)
+#define BMI270_CHIP_ID (0x24)
+#define BMI260_CHIP_ID (0x27)
+// the config files the kernel driver loads, 8KB each
+#define BMI26X_FIRMWARE_DIR "/lib/firmware/"
+#define BMI270_CONFIG_FILE "bmi270-init-data.fw"
+#define BMI260_CONFIG_FILE "bmi260-init-data.fw"
+#define BMI26X_CONFIG_SIZE (8192)
+// upload in chunks, the chip takes the start address in words
+#define BMI26X_CONFIG_CHUNK (256)
+
+#define BMI26X_CHIP_ID_ADDR (0x00)
+#define BMI26X_INT_STATUS_0_ADDR (0x1C)
+#define BMI26X_INTERNAL_STATUS_ADDR (0x21)
+#define BMI26X_TEMPERATURE_ADDR (0x22)
+#define BMI26X_FIFO_LENGTH_ADDR (0x24)
+#define BMI26X_FIFO_DATA_ADDR (0x26)
+#define BMI26X_FEAT_PAGE_ADDR (0x2F)
+#define BMI26X_FEATURES_ADDR (0x30)
+#define BMI26X_ACC_CONF_ADDR (0x40)
+#define BMI26X_ACC_RANGE_ADDR (0x41)
+#define BMI26X_GYR_CONF_ADDR (0x42)
+#define BMI26X_GYR_RANGE_ADDR (0x43)
+#define BMI26X_FIFO_CONFIG_0_ADDR (0x48)
+#define BMI26X_FIFO_CONFIG_1_ADDR (0x49)
+#define BMI26X_INT1_IO_CTRL_ADDR (0x53)
+#define BMI26X_INT_LATCH_ADDR (0x55)
+#define BMI26X_INT1_MAP_FEAT_ADDR (0x56)
+#define BMI26X_INIT_CTRL_ADDR (0x59)
+#define BMI26X_INIT_ADDR_0 (0x5B)
+#define BMI26X_INIT_DATA_ADDR (0x5E)
+#define BMI26X_PWR_CONF_ADDR (0x7C)
+#define BMI26X_PWR_CTRL_ADDR (0x7D)
+#define BMI26X_CMD_ADDR (0x7E)
+
+#define BMI26X_SOFT_RESET_CMD (0xB6)
+#define BMI26X_FIFO_FLUSH_CMD (0xB0)
+// internal status message once the config file runs
+#define BMI26X_INIT_MSG_MASK (0x0F)
+#define BMI26X_INIT_OK (0x01)
+#define BMI26X_INIT_POLL_MS (10)
+#define BMI26X_INIT_TIMEOUT_MS (150)
+// writes need 450us between them while advanced power save is on
+#define BMI26X_WRITE_DELAY_US (450)
+#define BMI26X_PWR_CTRL_GYR (0x02)
+#define BMI26X_PWR_CTRL_ACC (0x04)
+#define BMI26X_PWR_CTRL_TEMP (0x08)
+#define BMI26X_PWR_CONF_ADV_POWER_SAVE (0x01)
+#define BMI26X_PWR_CONF_FUP (0x02)
+
+// both sensors 200Hz, normal filter, performance mode, 2g and 2000dps
+#define BMI26X_ODR_200HZ (0x09)
+#define BMI26X_SENSOR_CONF (0xA0 | BMI26X_ODR_200HZ)
+#define BMI26X_ACC_RANGE_2G (0x00)
+#define BMI26X_GYR_RANGE_2000 (0x00)
+// the FIFO is drained every 10ms, 2 frames per read
+#define BMI26X_POLL_US (10000)
+// burst capture at 800Hz, 8 frames per read, given up after 1s
+#define BMI26X_ODR_800HZ (0x0B)
+#define BMI26X_BURST_CONF (0xA0 | BMI26X_ODR_800HZ)
+#define BMI26X_BURST_TIMEOUT_MS (1000)
+
+// header mode, gyro + accel + sensortime, overwrite the oldest when full
+#define BMI26X_FIFO_CONFIG_0 (0x02)
+#define BMI26X_FIFO_CONFIG_1 (0xD0)
+#define BMI26X_FIFO_SIZE (2048)
+#define BMI26X_FIFO_FRAME_LEN (13)
+#define BMI26X_FIFO_SENSORTIME_LEN (4)
+#define BMI26X_FIFO_INPUT_CONFIG_LEN (4)
+
+// any-motion and no-motion of the feature engine, 4 bytes each in the
+// feature pages: duration (20ms steps) with x/y/z select, threshold (g/2048
+// steps) with enable. Same thresholds as the BMI160, no-motion after 5s.
+#define BMI26X_ANY_MOTION_PAGE (1)
+#define BMI26X_ANY_MOTION_OFFSET (0x0C)
+#define BMI26X_NO_MOTION_PAGE (2)
+#define BMI26X_NO_MOTION_OFFSET (0x00)
+#define BMI26X_MOTION_AXES (0xE000)
+#define BMI26X_MOTION_ENABLE (0x8000)
+#define BMI26X_ANY_MOTION_THRESHOLD (160)
+#define BMI26X_ANY_MOTION_DURATION (1)
+#define BMI26X_NO_MOTION_THRESHOLD (80)
+#define BMI26X_NO_MOTION_DURATION (250)
+// INT_STATUS_0 and INT1_MAP_FEAT bits
+#define BMI26X_INT_NO_MOTION (0x20)
+#define BMI26X_INT_ANY_MOTION (0x40)
+
+// the config file for a chip id, path overrides the file name
+std::vector<uint8_t> bmi26x_load_config(const std::string &path, uint8_t chip_id);
+
+/*
+BMI260/BMI270 driven from userspace. The chip only runs after the config
+file is uploaded, its feature engine then provides any-motion and
+no-motion. Samples are drained from the header mode FIFO in one burst per
+poll and decoded by FifoDecoder. Bus is I2cBus, or Bmi26xSimBus to run
+against the register level simulator.
+*/
+template <typename Bus>
+class Bmi26xBackend
+{
+private:
+    Bus bus;
+    bool opened = false;
+    // kept for recovery
+    std::vector<uint8_t> config;
+    PowerState power_state = POWER_OFF;
+    BackendHealth health;
+    float g_ratio = 16384, dps_ratio = 16.4;
+    std::chrono::microseconds poll_period{BMI26X_POLL_US};
+    std::chrono::steady_clock::time_point next;
+    FifoDecoder decoder;
+    FifoBlock block;
+    uint8_t fifo[FIFO_BLOCK_MAX * BMI26X_FIFO_FRAME_LEN + BMI26X_FIFO_SENSORTIME_LEN];
+    // sensortime with its wraps counted
+    uint32_t sensortime = 0;
+    int64_t ticks = 0;
+    bool has_sensortime = false;
+
+    bool writeReg(uint8_t reg, uint8_t value)
+    {
+        bool ok = bus.write(reg, &value, 1);
+        usleep(BMI26X_WRITE_DELAY_US);
+        return ok;
+    }
+
+    uint8_t readReg(uint8_t reg)
+    {
+        uint8_t value = 0;
+        bus.read(reg, &value, 1);
+        return value;
+    }
+
+    /*
+    advanced power save off, then the file in chunks, each with its word
+    address, then wait for the init message
+    */
+    bool uploadConfig(const std::vector<uint8_t> &config)
+    {
+        if (!writeReg(BMI26X_PWR_CONF_ADDR, 0) || !writeReg(BMI26X_INIT_CTRL_ADDR, 0))
+            return false;
+        for (size_t offset = 0; offset < config.size(); offset += BMI26X_CONFIG_CHUNK)
+        {
+            size_t word = offset / 2;
+            uint8_t addr[2] = {static_cast<uint8_t>(word & 0x0F), static_cast<uint8_t>(word >> 4)};
+            size_t len = std::min<size_t>(BMI26X_CONFIG_CHUNK, config.size() - offset);
+            if (!bus.write(BMI26X_INIT_ADDR_0, addr, 2) ||
+                !bus.write(BMI26X_INIT_DATA_ADDR, config.data() + offset, len))
+                return false;
+        }
+        if (!writeReg(BMI26X_INIT_CTRL_ADDR, 1))
+            return false;
+        for (int waited = 0; waited <= BMI26X_INIT_TIMEOUT_MS; waited += BMI26X_INIT_POLL_MS)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(BMI26X_INIT_POLL_MS));
+            if ((readReg(BMI26X_INTERNAL_STATUS_ADDR) & BMI26X_INIT_MSG_MASK) == BMI26X_INIT_OK)
+                return true;
+        }
+        return false;
+    }
+
+    bool writeFeature(uint8_t page, uint8_t offset, uint16_t duration, uint16_t threshold)
+    {
+        uint8_t data[4] = {
+            static_cast<uint8_t>(duration), static_cast<uint8_t>(duration >> 8),
+            static_cast<uint8_t>(threshold), static_cast<uint8_t>(threshold >> 8)};
+        return writeReg(BMI26X_FEAT_PAGE_ADDR, page) &&
+               bus.write(BMI26X_FEATURES_ADDR + offset, data, 4);
+    }
+
+    /*
+    latched and mapped to INT1 with the pin output disabled, they are only
+    read back from INT_STATUS_0
+    */
+    bool setupMotionFeatures()
+    {
+        return writeFeature(BMI26X_ANY_MOTION_PAGE, BMI26X_ANY_MOTION_OFFSET,
+                            BMI26X_ANY_MOTION_DURATION | BMI26X_MOTION_AXES,
+                            BMI26X_ANY_MOTION_THRESHOLD | BMI26X_MOTION_ENABLE) &&
+               writeFeature(BMI26X_NO_MOTION_PAGE, BMI26X_NO_MOTION_OFFSET,
+                            BMI26X_NO_MOTION_DURATION | BMI26X_MOTION_AXES,
+                            BMI26X_NO_MOTION_THRESHOLD | BMI26X_MOTION_ENABLE) &&
+               writeReg(BMI26X_INT1_IO_CTRL_ADDR, 0) &&
+               writeReg(BMI26X_INT_LATCH_ADDR, 1) &&
+               writeReg(BMI26X_INT1_MAP_FEAT_ADDR, BMI26X_INT_ANY_MOTION | BMI26X_INT_NO_MOTION);
+    }
+
+    // rates, ranges and the FIFO, lost with the config file
+    bool writeSensorConfig()
+    {
+        return writeReg(BMI26X_ACC_CONF_ADDR, BMI26X_SENSOR_CONF) &&
+               writeReg(BMI26X_ACC_RANGE_ADDR, BMI26X_ACC_RANGE_2G) &&
+               writeReg(BMI26X_GYR_CONF_ADDR, BMI26X_SENSOR_CONF) &&
+               writeReg(BMI26X_GYR_RANGE_ADDR, BMI26X_GYR_RANGE_2000) &&
+               writeReg(BMI26X_FIFO_CONFIG_0_ADDR, BMI26X_FIFO_CONFIG_0) &&
+               writeReg(BMI26X_FIFO_CONFIG_1_ADDR, BMI26X_FIFO_CONFIG_1);
+    }
+
+public:
+    static constexpr bool has_motion_interrupts = true;
+    static constexpr bool has_burst_capture = true;
+    // the feature engine's gestures differ per config file, none are used
+    static constexpr bool has_gestures = false;
+
+    Bmi26xBackend(const std::vector<uint8_t> &config_file,
+                  const std::string &bus_path = I2C_BUS_PATH, uint8_t addr = BMI26X_I2C_ADDR) : config(config_file)
+    {
+        if (!bus.open(bus_path.c_str(), addr))
+            return;
+        // a chip still running its config file from an earlier run is
+        // taken over, only the registers below are written again
+        auto chip_id = readReg(BMI26X_CHIP_ID_ADDR);
+        bool warm = (chip_id == BMI260_CHIP_ID || chip_id == BMI270_CHIP_ID) &&
+                    (readReg(BMI26X_INTERNAL_STATUS_ADDR) & BMI26X_INIT_MSG_MASK) == BMI26X_INIT_OK;
+        if (!warm)
+        {
+            writeReg(BMI26X_CMD_ADDR, BMI26X_SOFT_RESET_CMD);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            chip_id = readReg(BMI26X_CHIP_ID_ADDR);
+        }
+        if (chip_id != BMI260_CHIP_ID && chip_id != BMI270_CHIP_ID)
+        {
+            std::cout << "bmi26x chip id err! " << +chip_id << std::endl;
+            return;
+        }
+        if (warm)
+            std::cout << "bmi26x warm attach" << std::endl;
+        else if (!uploadConfig(config_file))
+        {
+            std::cout << "bmi26x config upload err!" << std::endl;
+            return;
+        }
+        opened = writeSensorConfig();
+        if (!opened)
+            return;
+        if (!setupMotionFeatures())
+            std::cout << "bmi26x motion features err!" << std::endl;
+        decoder.configure(g_ratio, dps_ratio, BMI26X_ODR_200HZ, BMI26X_FIFO_INPUT_CONFIG_LEN);
+        setPowerState(POWER_ACTIVE);
+    };
+    Bmi26xBackend(const Bmi26xBackend &) = delete;
+    bool isOpen() const { return opened; };
+    int getSamplePeriodUs() const { return sensortime_ns(decoder.getPeriod()) / 1000; };
+
+    /*
+    off: advanced power save with everything disabled. idle: accel only
+    for the feature engine, gyro fast start-up. The FIFO is flushed and the
+    latched motion status cleared on every change.
+    */
+    void setPowerState(PowerState state)
+    {
+        power_state = state;
+        switch (state)
+        {
+        case POWER_OFF:
+            writeReg(BMI26X_PWR_CTRL_ADDR, 0);
+            writeReg(BMI26X_PWR_CONF_ADDR, BMI26X_PWR_CONF_ADV_POWER_SAVE);
+            break;
+        case POWER_IDLE:
+            writeReg(BMI26X_PWR_CONF_ADDR, BMI26X_PWR_CONF_FUP);
+            writeReg(BMI26X_PWR_CTRL_ADDR, BMI26X_PWR_CTRL_ACC | BMI26X_PWR_CTRL_TEMP);
+            break;
+        case POWER_ACTIVE:
+            writeReg(BMI26X_PWR_CONF_ADDR, 0);
+            writeReg(BMI26X_PWR_CTRL_ADDR, BMI26X_PWR_CTRL_ACC | BMI26X_PWR_CTRL_GYR | BMI26X_PWR_CTRL_TEMP);
+            break;
+        }
+        writeReg(BMI26X_CMD_ADDR, BMI26X_FIFO_FLUSH_CMD);
+        readReg(BMI26X_INT_STATUS_0_ADDR);
+        next = std::chrono::steady_clock::now();
+    }
+
+    bool readTemperature(float &celsius)
+    {
+        uint8_t data[2];
+        if (!bus.read(BMI26X_TEMPERATURE_ADDR, data, 2))
+            return false;
+        auto raw = static_cast<int16_t>(data[0] | data[1] << 8);
+        if (raw == INT16_MIN)
+            return false;
+        celsius = 23 + raw / 512.0f;
+        return true;
+    }
+
+    bool anyMotion() { return readReg(BMI26X_INT_STATUS_0_ADDR) & BMI26X_INT_ANY_MOTION; };
+    bool noMotion() { return readReg(BMI26X_INT_STATUS_0_ADDR) & BMI26X_INT_NO_MOTION; };
+    const BackendHealth &getHealth() const { return health; };
+
+    /*
+    a fresh bus client, then the sensor config, motion features and power
+    state written again. The config file is only uploaded again when the
+    chip lost it, the init wait alone then takes longer than a register
+    restore.
+    */
+    bool recover()
+    {
+        uint8_t status = 0;
+        if (!bus.reopen() || !bus.read(BMI26X_INTERNAL_STATUS_ADDR, &status, 1))
+        {
+            health.bus_errors++;
+            return false;
+        }
+        if ((status & BMI26X_INIT_MSG_MASK) != BMI26X_INIT_OK)
+        {
+            std::cout << "bmi26x lost its config, uploading again" << std::endl;
+            if (!uploadConfig(config))
+                return false;
+        }
+        if (!writeSensorConfig() || !setupMotionFeatures())
+            return false;
+        setPowerState(power_state);
+        has_sensortime = false;
+        return true;
+    }
+
+    /*
+    both sensors at 800Hz, drained by read() until max readings are in. The
+    FIFO is flushed on both rate changes, so every read decodes one rate.
+    */
+    size_t captureBurst(ImuReading *readings, size_t max)
+    {
+        size_t count = 0;
+        if (writeReg(BMI26X_ACC_CONF_ADDR, BMI26X_BURST_CONF) &&
+            writeReg(BMI26X_GYR_CONF_ADDR, BMI26X_BURST_CONF) &&
+            writeReg(BMI26X_CMD_ADDR, BMI26X_FIFO_FLUSH_CMD))
+        {
+            decoder.configure(g_ratio, dps_ratio, BMI26X_ODR_800HZ, BMI26X_FIFO_INPUT_CONFIG_LEN);
+            next = std::chrono::steady_clock::now();
+            auto deadline = next + std::chrono::milliseconds(BMI26X_BURST_TIMEOUT_MS);
+            while (count < max && std::chrono::steady_clock::now() < deadline)
+                count += read(readings + count, max - count);
+        }
+        else
+            std::cout << "bmi26x burst setup err!" << std::endl;
+        if (!writeSensorConfig() || !writeReg(BMI26X_CMD_ADDR, BMI26X_FIFO_FLUSH_CMD))
+            std::cout << "bmi26x burst restore err!" << std::endl;
+        decoder.configure(g_ratio, dps_ratio, BMI26X_ODR_200HZ, BMI26X_FIFO_INPUT_CONFIG_LEN);
+        next = std::chrono::steady_clock::now();
+        return count;
+    }
+
+    uint32_t gestures() { return 0; };
+
+    /*
+    the FIFO length, then one burst of the frames plus the sensortime frame
+    behind them. When more than max frames are waiting only whole frames
+    are read, the rest stays for the next poll.
+    */
+    inline size_t read(ImuReading *readings, size_t max)
+    {
+        std::this_thread::sleep_until(next);
+        next += poll_period;
+        uint8_t length[2];
+        if (max == 0)
+            return 0;
+        if (!bus.read(BMI26X_FIFO_LENGTH_ADDR, length, 2))
+        {
+            health.bus_errors++;
+            return 0;
+        }
+        size_t len = length[0] | (length[1] & 0x3F) << 8;
+        if (len == 0)
+        {
+            health.stalls++;
+            return 0;
+        }
+        size_t cap = std::min<size_t>(max, FIFO_BLOCK_MAX) * BMI26X_FIFO_FRAME_LEN;
+        len = len <= cap ? len + BMI26X_FIFO_SENSORTIME_LEN : cap;
+        if (!bus.readFifo(BMI26X_FIFO_DATA_ADDR, fifo, len))
+        {
+            health.bus_errors++;
+            return 0;
+        }
+        decoder.decode(fifo, len, block);
+        health.overflows += block.overflows;
+
+        size_t count = 0;
+        for (size_t k = 0; k < block.count; k++)
+        {
+            uint32_t step = (block.sensortime[k] - sensortime) & SENSORTIME_MASK;
+            if (has_sensortime && step == 0)
+                continue;
+            if (has_sensortime)
+                ticks += step;
+            sensortime = block.sensortime[k];
+            has_sensortime = true;
+
+            auto &reading = readings[count++];
+            reading.timestamp = sensortime_ns(ticks);
+            reading.gyro_x = block.gyro_x[k];
+            reading.gyro_y = block.gyro_y[k];
+            reading.gyro_z = block.gyro_z[k];
+            reading.accel_x = block.accel_x[k];
+            reading.accel_y = block.accel_y[k];
+            reading.accel_z = block.accel_z[k];
+        }
+        return count;
+    }
+};
+
+#endif
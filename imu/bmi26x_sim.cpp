@@ -0,0 +1,283 @@
+#include "bmi26x_sim.h"
+#include "sim_backend.h"
+#include <math.h>
+#include <string.h>
+#include <iostream>
+
+static void put16(uint8_t *data, float value)
+{
+    auto raw = static_cast<int16_t>(std::clamp<float>(lroundf(value), INT16_MIN, INT16_MAX));
+    data[0] = raw & 0xFF;
+    data[1] = (raw >> 8) & 0xFF;
+}
+
+Bmi26xSimBus::Bmi26xSimBus(uint8_t chip_id) : chip_id(chip_id), config(BMI26X_CONFIG_SIZE)
+{
+    reset();
+}
+
+// sensortime ticks since the simulator started
+int64_t Bmi26xSimBus::now() const
+{
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / BMI26X_SIM_TICK_NS;
+}
+
+void Bmi26xSimBus::reset()
+{
+    memset(regs, 0, sizeof(regs));
+    memset(features, 0, sizeof(features));
+    regs[BMI26X_CHIP_ID_ADDR] = chip_id;
+    regs[BMI26X_PWR_CONF_ADDR] = BMI26X_SIM_PWR_CONF;
+    regs[BMI26X_ACC_CONF_ADDR] = BMI26X_SIM_ACC_CONF;
+    regs[BMI26X_GYR_CONF_ADDR] = BMI26X_SIM_GYR_CONF;
+    regs[BMI26X_FIFO_CONFIG_0_ADDR] = BMI26X_FIFO_CONFIG_0;
+    regs[BMI26X_FIFO_CONFIG_1_ADDR] = BMI26X_SIM_FIFO_CONFIG_1;
+    config_written = 0;
+    frames.clear();
+    fifo_bytes = 0;
+    front_offset = 0;
+    skipped = 0;
+    next_frame = now();
+}
+
+/*
+samples due since the last access, at the gyro rate while the gyro runs,
+the accel rate otherwise. Nothing is sampled before the config file runs.
+*/
+void Bmi26xSimBus::advance()
+{
+    auto ticks = now();
+    uint8_t pwr = regs[BMI26X_PWR_CTRL_ADDR];
+    bool running = regs[BMI26X_INTERNAL_STATUS_ADDR] == BMI26X_INIT_OK &&
+                   (pwr & (BMI26X_PWR_CTRL_ACC | BMI26X_PWR_CTRL_GYR));
+    if (!running)
+    {
+        next_frame = ticks;
+        return;
+    }
+    uint8_t conf = regs[pwr & BMI26X_PWR_CTRL_GYR ? BMI26X_GYR_CONF_ADDR : BMI26X_ACC_CONF_ADDR];
+    uint8_t odr = std::clamp<uint8_t>(conf & 0x0F, BMI160_GYRO_ODR_25HZ, BMI160_GYRO_ODR_3200HZ);
+    int64_t period = 1 << (16 - odr);
+    // at most one FIFO worth after a long pause
+    next_frame = std::max(next_frame, ticks - period * FIFO_BLOCK_MAX * 2);
+    for (; next_frame <= ticks; next_frame += period)
+        pushFrame(next_frame);
+}
+
+/*
+gyro and accel as enabled in both FIFO_CONFIG_1 and PWR_CTRL, gyro data
+first. When the FIFO is full the oldest frames are dropped and reported
+with a skip frame.
+*/
+void Bmi26xSimBus::pushFrame(int64_t ticks)
+{
+    ImuReading reading;
+    SimBackend::motion(ticks * BMI26X_SIM_TICK_NS / 1e9, reading);
+    last_frame = ticks;
+    float g_ratio = 16384 >> (regs[BMI26X_ACC_RANGE_ADDR] & 0x03);
+    float dps_ratio = 16.4f * (1 << std::min(regs[BMI26X_GYR_RANGE_ADDR] & 0x07, 4));
+    uint8_t *data = regs + 0x0C;
+    put16(data, reading.accel_x * g_ratio);
+    put16(data + 2, reading.accel_y * g_ratio);
+    put16(data + 4, reading.accel_z * g_ratio);
+    put16(data + 6, reading.gyro_x * dps_ratio);
+    put16(data + 8, reading.gyro_y * dps_ratio);
+    put16(data + 10, reading.gyro_z * dps_ratio);
+
+    uint8_t pwr = regs[BMI26X_PWR_CTRL_ADDR];
+    uint8_t fifo_config = regs[BMI26X_FIFO_CONFIG_1_ADDR];
+    bool gyro = (fifo_config & 0x80) && (pwr & BMI26X_PWR_CTRL_GYR);
+    bool accel = (fifo_config & 0x40) && (pwr & BMI26X_PWR_CTRL_ACC);
+    if (!gyro && !accel)
+        return;
+    if (!(fifo_config & 0x10))
+    {
+        std::cout << "bmi26x sim headerless fifo err!" << std::endl;
+        return;
+    }
+    std::vector<uint8_t> frame = {static_cast<uint8_t>(FIFO_HEADER_REGULAR | (gyro ? FIFO_HEADER_GYRO : 0) | (accel ? FIFO_HEADER_ACCEL : 0))};
+    if (gyro)
+        frame.insert(frame.end(), data + 6, data + 12);
+    if (accel)
+        frame.insert(frame.end(), data, data + 6);
+    while (!frames.empty() && fifo_bytes + frame.size() > BMI26X_FIFO_SIZE)
+    {
+        fifo_bytes -= frames.front().size();
+        frames.pop_front();
+        front_offset = 0;
+        skipped++;
+    }
+    fifo_bytes += frame.size();
+    frames.push_back(std::move(frame));
+}
+
+void Bmi26xSimBus::startFifoRead()
+{
+    control.clear();
+    if (skipped)
+    {
+        control = {BMI160_FIFO_HEAD_SKIP_FRAME, static_cast<uint8_t>(std::min<uint32_t>(skipped, 0xFF))};
+        skipped = 0;
+    }
+}
+
+/*
+one byte of FIFO data: pending control frame, frames, the sensortime
+frame once the FIFO is empty, then over-read
+*/
+uint8_t Bmi26xSimBus::popFifo(bool &time_sent)
+{
+    if (!control.empty())
+    {
+        auto value = control.front();
+        control.pop_front();
+        return value;
+    }
+    if (!frames.empty())
+    {
+        auto &frame = frames.front();
+        auto value = frame[front_offset++];
+        if (front_offset == frame.size())
+        {
+            fifo_bytes -= frame.size();
+            frames.pop_front();
+            front_offset = 0;
+        }
+        return value;
+    }
+    if (!time_sent && (regs[BMI26X_FIFO_CONFIG_0_ADDR] & 0x02))
+    {
+        time_sent = true;
+        uint32_t time = last_frame & SENSORTIME_MASK;
+        control = {static_cast<uint8_t>(time), static_cast<uint8_t>(time >> 8), static_cast<uint8_t>(time >> 16)};
+        return BMI160_FIFO_HEAD_SENSOR_TIME;
+    }
+    return BMI160_FIFO_HEAD_OVER_READ;
+}
+
+uint8_t Bmi26xSimBus::readReg(uint8_t reg)
+{
+    uint32_t time = now() & SENSORTIME_MASK;
+    int16_t temperature = INT16_MIN;
+    if (regs[BMI26X_PWR_CTRL_ADDR] & BMI26X_PWR_CTRL_TEMP)
+        temperature = (BMI26X_SIM_TEMPERATURE - 23) * 512;
+    switch (reg)
+    {
+    case 0x18:
+    case 0x19:
+    case 0x1A:
+        return time >> (8 * (reg - 0x18));
+    case BMI26X_INT_STATUS_0_ADDR:
+    {
+        auto status = regs[reg];
+        regs[reg] = 0;
+        return status;
+    }
+    case BMI26X_TEMPERATURE_ADDR:
+        return temperature & 0xFF;
+    case BMI26X_TEMPERATURE_ADDR + 1:
+        return (temperature >> 8) & 0xFF;
+    case BMI26X_FIFO_LENGTH_ADDR:
+        return (fifo_bytes - front_offset) & 0xFF;
+    case BMI26X_FIFO_LENGTH_ADDR + 1:
+        return ((fifo_bytes - front_offset) >> 8) & 0x3F;
+    }
+    if (reg >= BMI26X_FEATURES_ADDR && reg < BMI26X_FEATURES_ADDR + 16)
+        return features[regs[BMI26X_FEAT_PAGE_ADDR] % BMI26X_SIM_FEATURE_PAGES][reg - BMI26X_FEATURES_ADDR];
+    return regs[reg & 0x7F];
+}
+
+/*
+index is the position in a burst, INIT_DATA keeps the address and takes
+the burst from INIT_ADDR on
+*/
+void Bmi26xSimBus::writeReg(uint8_t reg, uint8_t value, size_t index)
+{
+    bool initialized = regs[BMI26X_INTERNAL_STATUS_ADDR] == BMI26X_INIT_OK;
+    if (reg == BMI26X_INIT_DATA_ADDR)
+    {
+        if (regs[BMI26X_PWR_CONF_ADDR] & BMI26X_PWR_CONF_ADV_POWER_SAVE)
+            std::cout << "bmi26x sim config upload in power save err!" << std::endl;
+        size_t addr = 2 * ((regs[BMI26X_INIT_ADDR_0] & 0x0F) | regs[BMI26X_INIT_ADDR_0 + 1] << 4) + index;
+        if (addr < config.size())
+        {
+            config[addr] = value;
+            config_written++;
+        }
+        return;
+    }
+    if (reg >= BMI26X_FEATURES_ADDR && reg < BMI26X_FEATURES_ADDR + 16)
+    {
+        if (!initialized)
+            std::cout << "bmi26x sim feature write before init err!" << std::endl;
+        features[regs[BMI26X_FEAT_PAGE_ADDR] % BMI26X_SIM_FEATURE_PAGES][reg - BMI26X_FEATURES_ADDR] = value;
+        return;
+    }
+    switch (reg)
+    {
+    case BMI26X_CMD_ADDR:
+        if (value == BMI26X_SOFT_RESET_CMD)
+            reset();
+        else if (value == BMI26X_FIFO_FLUSH_CMD)
+        {
+            frames.clear();
+            fifo_bytes = 0;
+            front_offset = 0;
+            skipped = 0;
+        }
+        return;
+    case BMI26X_INIT_CTRL_ADDR:
+        if (value == 0)
+            config_written = 0;
+        else if (value == 1)
+            regs[BMI26X_INTERNAL_STATUS_ADDR] = config_written >= config.size() ? BMI26X_INIT_OK : 0x02;
+        regs[reg] = value;
+        return;
+    case BMI26X_PWR_CTRL_ADDR:
+        if (!initialized && value)
+            std::cout << "bmi26x sim power on before init err!" << std::endl;
+        regs[reg] = value;
+        next_frame = now();
+        return;
+    case BMI26X_CHIP_ID_ADDR:
+    case BMI26X_INTERNAL_STATUS_ADDR:
+        std::cout << "bmi26x sim read only register err! " << +reg << std::endl;
+        return;
+    }
+    regs[reg & 0x7F] = value;
+}
+
+/*
+addresses increment within a burst except FIFO data, which is trapped,
+frames cut short by the burst end are delivered again by the next one
+*/
+bool Bmi26xSimBus::read(uint8_t reg, uint8_t *data, uint16_t len)
+{
+    advance();
+    if (reg == BMI26X_FIFO_DATA_ADDR)
+    {
+        bool time_sent = false;
+        startFifoRead();
+        for (uint16_t i = 0; i < len; i++)
+            data[i] = popFifo(time_sent);
+        front_offset = 0;
+        return true;
+    }
+    for (uint16_t i = 0; i < len; i++)
+        data[i] = readReg(reg + i);
+    return true;
+}
+
+bool Bmi26xSimBus::write(uint8_t reg, const uint8_t *data, uint16_t len)
+{
+    advance();
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (reg == BMI26X_INIT_DATA_ADDR)
+            writeReg(reg, data[i], i);
+        else
+            writeReg(reg + i, data[i], i);
+    }
+    return true;
+}
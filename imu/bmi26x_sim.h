@@ -0,0 +1,69 @@
+#ifndef BMI26X_SIM_HEADER
+#define BMI26X_SIM_HEADER
+#include "bmi26x_backend.h"
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// default values after power on or soft reset
+#define BMI26X_SIM_PWR_CONF (0x03)
+#define BMI26X_SIM_ACC_CONF (0xA8)
+#define BMI26X_SIM_GYR_CONF (0xA9)
+#define BMI26X_SIM_FIFO_CONFIG_1 (0x10)
+#define BMI26X_SIM_FEATURE_PAGES (8)
+#define BMI26X_SIM_TEMPERATURE (25)
+// exact sensortime tick, 39.0625us
+#define BMI26X_SIM_TICK_NS (39062.5)
+
+/*
+Register level BMI260 behind the I2cBus interface, so Bmi26xBackend runs
+unchanged without hardware. It models what the backend relies on: chip
+id and soft reset, the config upload through INIT_ADDR/INIT_DATA and the
+init status, power control, paged feature memory, temperature, the data
+registers and a header mode FIFO with skip, sensortime and over-read
+frames, including partially read frames being read again. The sensortime
+frame carries the time of the last frame. Samples are SimBackend's signal
+at the configured rate and range. The feature engine does not run, motion
+status stays 0. Protocol violations print an err.
+*/
+class Bmi26xSimBus
+{
+private:
+    uint8_t chip_id;
+    uint8_t regs[128];
+    uint8_t features[BMI26X_SIM_FEATURE_PAGES][16];
+    std::vector<uint8_t> config;
+    size_t config_written = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // sensortime ticks of the next and the last sample
+    int64_t next_frame = 0;
+    int64_t last_frame = 0;
+
+    std::deque<std::vector<uint8_t>> frames;
+    size_t fifo_bytes = 0;
+    // bytes of the front frame read so far in the current burst
+    size_t front_offset = 0;
+    uint32_t skipped = 0;
+    std::deque<uint8_t> control;
+
+    int64_t now() const;
+    void reset();
+    void advance();
+    void pushFrame(int64_t ticks);
+    void startFifoRead();
+    uint8_t popFifo(bool &time_sent);
+    uint8_t readReg(uint8_t reg);
+    void writeReg(uint8_t reg, uint8_t value, size_t index);
+
+public:
+    Bmi26xSimBus(uint8_t chip_id = BMI260_CHIP_ID);
+    Bmi26xSimBus(const Bmi26xSimBus &) = delete;
+    bool open(const char *path, uint8_t addr) { return true; };
+    bool reopen() { return true; };
+    bool isOpen() const { return true; };
+    bool read(uint8_t reg, uint8_t *data, uint16_t len);
+    bool readFifo(uint8_t reg, uint8_t *data, uint16_t len) { return read(reg, data, len); };
+    bool write(uint8_t reg, const uint8_t *data, uint16_t len);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "burst_calibration.h"
+#include <math.h>
+
+void BurstCalibration::reset()
+{
+    *this = BurstCalibration();
+}
+
+// Welford's update, stable for the small spread of a still device
+void BurstCalibration::push(const ImuReading &reading)
+{
+    double values[4] = {
+        reading.gyro_x,
+        reading.gyro_y,
+        reading.gyro_z,
+        sqrt(reading.accel_x * reading.accel_x + reading.accel_y * reading.accel_y + reading.accel_z * reading.accel_z)};
+    count++;
+    for (int i = 0; i < 4; i++)
+    {
+        double delta = values[i] - mean[i];
+        mean[i] += delta / count;
+        m2[i] += delta * (values[i] - mean[i]);
+    }
+}
+
+CalibrationResult BurstCalibration::finish() const
+{
+    CalibrationResult result;
+    result.samples = count;
+    result.x = mean[0];
+    result.y = mean[1];
+    result.z = mean[2];
+    result.state = CALIBRATION_DONE;
+    auto max_gyro_var = BURST_CALIBRATION_MAX_GYRO_SD * BURST_CALIBRATION_MAX_GYRO_SD * (count - 1);
+    auto max_accel_var = BURST_CALIBRATION_MAX_ACCEL_SD * BURST_CALIBRATION_MAX_ACCEL_SD * (count - 1);
+    if (count < 2 || m2[0] > max_gyro_var || m2[1] > max_gyro_var || m2[2] > max_gyro_var || m2[3] > max_accel_var)
+        result.state = CALIBRATION_MOVED;
+    return result;
+}
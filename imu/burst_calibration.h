@@ -0,0 +1,51 @@
+#ifndef BURST_CALIBRATION_HEADER
+#define BURST_CALIBRATION_HEADER
+#include "imu_backend.h"
+
+// readings per calibration, 200ms at the 800Hz burst rate. Backends
+// without burst capture collect at their own rate for this long instead,
+// but at least the minimum
+#define BURST_CALIBRATION_SAMPLES (160)
+#define BURST_CALIBRATION_MIN_SAMPLES (50)
+#define BURST_CALIBRATION_WINDOW_US (500000)
+// spread of a device lying still, gyro per axis (dps), accel magnitude (g)
+#define BURST_CALIBRATION_MAX_GYRO_SD (0.5)
+#define BURST_CALIBRATION_MAX_ACCEL_SD (0.01)
+
+enum CalibrationState
+{
+    CALIBRATION_NONE,
+    CALIBRATION_RUNNING,
+    CALIBRATION_DONE,
+    CALIBRATION_MOVED, // rejected, the device was not still
+};
+
+struct CalibrationResult
+{
+    CalibrationState state = CALIBRATION_NONE;
+    float x = 0, y = 0, z = 0; // gyro bias, dps
+    int samples = 0;
+};
+
+/*
+Gyro bias of a short burst of readings, averaged like GamepadMotion's
+continuous calibration does (the sum over the count, the count is the
+weight). Running variances of the gyro axes and the accel magnitude
+reject a burst taken while the device moved.
+*/
+class BurstCalibration
+{
+private:
+    int count = 0;
+    // gyro x y z, accel magnitude
+    double mean[4] = {0, 0, 0, 0};
+    double m2[4] = {0, 0, 0, 0};
+
+public:
+    void reset();
+    void push(const ImuReading &reading);
+    int getCount() const { return count; };
+    CalibrationResult finish() const;
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "fifo_decoder.h"
+
+static inline int16_t le16(const uint8_t *data)
+{
+    return static_cast<int16_t>(data[0] | data[1] << 8);
+}
+
+/*
+scale int16 to float, kept a plain loop over aligned arrays so it
+vectorizes
+*/
+static void scale(const int16_t *__restrict in, float *__restrict out, size_t count, float factor)
+{
+    for (size_t i = 0; i < count; i++)
+        out[i] = in[i] * factor;
+}
+
+/*
+gyro odr 100Hz * 2^(odr - 8), sensortime ticks 39.0625us, so the period
+is 2^(16 - odr) ticks
+*/
+void FifoDecoder::configure(float g_ratio, float dps_ratio, uint8_t gyro_odr, size_t input_config_size)
+{
+    this->input_config_size = input_config_size;
+    g_scale = 1 / g_ratio;
+    dps_scale = 1 / dps_ratio;
+    if (gyro_odr >= BMI160_GYRO_ODR_25HZ && gyro_odr <= BMI160_GYRO_ODR_3200HZ)
+        period = 1 << (16 - gyro_odr);
+}
+
+void FifoDecoder::reset()
+{
+    accel_raw[0] = accel_raw[1] = accel_raw[2] = 0;
+    has_sensortime = false;
+}
+
+void FifoDecoder::decode(const uint8_t *buf, size_t len, FifoBlock &block)
+{
+    block.count = 0;
+    block.timed = false;
+    block.skipped = 0;
+    block.overflows = 0;
+    block.dropped = 0;
+    block.invalid = 0;
+
+    // position of each sample in gyro periods, skipped frames included
+    auto *position = block.sensortime;
+    uint32_t next_position = 0;
+    uint32_t sensortime = 0;
+    size_t n = 0;
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t header = buf[i] & FIFO_HEADER_MASK;
+        // over-read, the FIFO is empty
+        if (header == BMI160_FIFO_HEAD_OVER_READ)
+            break;
+
+        size_t size;
+        if ((header & 0xC0) == FIFO_HEADER_REGULAR)
+            size = (header & FIFO_HEADER_MAG ? BMI160_FIFO_M_LENGTH : 0) +
+                   (header & FIFO_HEADER_GYRO ? BMI160_FIFO_G_LENGTH : 0) +
+                   (header & FIFO_HEADER_ACCEL ? BMI160_FIFO_A_LENGTH : 0);
+        else if (header == BMI160_FIFO_HEAD_SENSOR_TIME)
+            size = BMI160_SENSOR_TIME_LENGTH;
+        else if (header == BMI160_FIFO_HEAD_SKIP_FRAME)
+            size = 1;
+        else if (header == BMI160_FIFO_HEAD_INPUT_CONFIG)
+            size = input_config_size;
+        else
+        {
+            block.invalid += len - i;
+            break;
+        }
+        if (i + 1 + size > len)
+        {
+            block.invalid += len - i;
+            break;
+        }
+        const uint8_t *data = buf + i + 1;
+        i += 1 + size;
+
+        if (header == BMI160_FIFO_HEAD_SENSOR_TIME)
+        {
+            sensortime = data[0] | data[1] << 8 | data[2] << 16;
+            block.timed = true;
+            continue;
+        }
+        if (header == BMI160_FIFO_HEAD_SKIP_FRAME)
+        {
+            block.overflows++;
+            block.skipped += data[0];
+            next_position += data[0];
+            continue;
+        }
+        if (header == BMI160_FIFO_HEAD_INPUT_CONFIG)
+            continue;
+
+        // regular frame, mag first, then gyro, then accel
+        if (header & FIFO_HEADER_MAG)
+            data += BMI160_FIFO_M_LENGTH;
+        const uint8_t *gyro = nullptr;
+        if (header & FIFO_HEADER_GYRO)
+        {
+            gyro = data;
+            data += BMI160_FIFO_G_LENGTH;
+        }
+        if (header & FIFO_HEADER_ACCEL)
+        {
+            accel_raw[0] = le16(data);
+            accel_raw[1] = le16(data + 2);
+            accel_raw[2] = le16(data + 4);
+        }
+        if (!gyro)
+            continue;
+        if (n == FIFO_BLOCK_MAX)
+        {
+            block.dropped++;
+            next_position++;
+            continue;
+        }
+        raw[0][n] = le16(gyro);
+        raw[1][n] = le16(gyro + 2);
+        raw[2][n] = le16(gyro + 4);
+        raw[3][n] = accel_raw[0];
+        raw[4][n] = accel_raw[1];
+        raw[5][n] = accel_raw[2];
+        position[n] = next_position++;
+        n++;
+    }
+
+    scale(raw[0], block.gyro_x, n, dps_scale);
+    scale(raw[1], block.gyro_y, n, dps_scale);
+    scale(raw[2], block.gyro_z, n, dps_scale);
+    scale(raw[3], block.accel_x, n, g_scale);
+    scale(raw[4], block.accel_y, n, g_scale);
+    scale(raw[5], block.accel_z, n, g_scale);
+    block.count = n;
+
+    // the sensortime frame is the time of the last frame, count back from
+    // it, without one continue from the previous block
+    if (block.timed)
+    {
+        uint32_t last = n ? position[n - 1] : 0;
+        for (size_t k = 0; k < n; k++)
+            block.sensortime[k] = (sensortime - (last - position[k]) * period) & SENSORTIME_MASK;
+        next_sensortime = (sensortime + period) & SENSORTIME_MASK;
+        has_sensortime = true;
+    }
+    else if (n)
+    {
+        for (size_t k = 0; k < n; k++)
+            block.sensortime[k] = (next_sensortime + position[k] * period) & SENSORTIME_MASK;
+        next_sensortime = (block.sensortime[n - 1] + period) & SENSORTIME_MASK;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef FIFO_DECODER_HEADER
+#define FIFO_DECODER_HEADER
+#include <stddef.h>
+#include <stdint.h>
+#include "bmi160/bmi160_defs.h"
+
+// sensortime is a 24 bit counter ticking every 39.0625us
+#define SENSORTIME_MASK (0xFFFFFF)
+// 1KB FIFO, 13 byte gyro + accel frames fit at most 78 times
+#define FIFO_SIZE (1024)
+#define FIFO_BLOCK_MAX (80)
+// header byte: mode in bits 7..6, sensors or control type in 5..2
+#define FIFO_HEADER_MASK (0xFC)
+#define FIFO_HEADER_REGULAR (0x80)
+#define FIFO_HEADER_MAG (0x10)
+#define FIFO_HEADER_GYRO (0x08)
+#define FIFO_HEADER_ACCEL (0x04)
+
+// sensortime ticks to ns, exact
+inline int64_t sensortime_ns(int64_t ticks)
+{
+    return ticks * 78125 / 2;
+}
+
+/*
+Decoded FIFO samples as separate arrays per axis, gyro in dps, accel in g.
+Every sample has a gyro reading, the accel is the latest one at that time.
+*/
+struct FifoBlock
+{
+    size_t count = 0;
+    alignas(32) float gyro_x[FIFO_BLOCK_MAX];
+    alignas(32) float gyro_y[FIFO_BLOCK_MAX];
+    alignas(32) float gyro_z[FIFO_BLOCK_MAX];
+    alignas(32) float accel_x[FIFO_BLOCK_MAX];
+    alignas(32) float accel_y[FIFO_BLOCK_MAX];
+    alignas(32) float accel_z[FIFO_BLOCK_MAX];
+    // 24 bit sensortime of each sample
+    alignas(32) uint32_t sensortime[FIFO_BLOCK_MAX];
+    // false if the buffer had no sensortime frame and the times are only
+    // extrapolated from the previous block
+    bool timed = false;
+    // frames the chip dropped because the FIFO was full, skip frames seen
+    uint32_t skipped = 0;
+    uint32_t overflows = 0;
+    // samples that did not fit the block, bytes of an unknown or cut frame
+    uint32_t dropped = 0;
+    uint32_t invalid = 0;
+};
+
+/*
+Header mode FIFO decoder for gyro + accel (+ sensortime) frames. The
+buffer is walked once, collecting raw values, then scaled in one loop per
+axis. State carries over between reads: the last accel value for gyro
+only frames and the sensortime for reads without a sensortime frame.
+*/
+class FifoDecoder
+{
+private:
+    float g_scale = 1, dps_scale = 1;
+    // gyro sample period in sensortime ticks
+    uint32_t period = 256;
+    size_t input_config_size = 1;
+    int16_t accel_raw[3] = {0, 0, 0};
+    uint32_t next_sensortime = 0;
+    bool has_sensortime = false;
+
+    alignas(32) int16_t raw[6][FIFO_BLOCK_MAX];
+
+public:
+    // ratios are lsb per g and lsb per dps, odr the BMI160_GYRO_ODR_* code
+    // (same codes on the BMI26x), BMI26x input config frames carry 4 bytes
+    void configure(float g_ratio, float dps_ratio, uint8_t gyro_odr, size_t input_config_size = 1);
+    void reset();
+    uint32_t getPeriod() const { return period; };
+    void decode(const uint8_t *buf, size_t len, FifoBlock &block);
+};
+
+#endif
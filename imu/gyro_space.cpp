@@ -0,0 +1,27 @@
+#include "gyro_space.h"
+
+bool parse_gyro_space(const std::string &text, GyroSpace &space)
+{
+    if (text == "local")
+        space = GYRO_LOCAL;
+    else if (text == "world")
+        space = GYRO_WORLD;
+    else if (text == "player")
+        space = GYRO_PLAYER;
+    else
+        return false;
+    return true;
+}
+
+const char *gyro_space_name(GyroSpace space)
+{
+    switch (space)
+    {
+    case GYRO_WORLD:
+        return "world";
+    case GYRO_PLAYER:
+        return "player";
+    default:
+        return "local";
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef GYRO_SPACE_HEADER
+#define GYRO_SPACE_HEADER
+#include <math.h>
+#include <string>
+
+/*
+How device rotation turns into yaw/pitch, see GyroWiki "Player Space Gyro".
+Device axes as mounted: x points up when the handheld is held, y is the
+pitch axis and z the roll axis, so local yaw is gyro_x.
+*/
+enum GyroSpace
+{
+    GYRO_LOCAL = 0,  // device axes, tilting the handheld changes the aim
+    GYRO_WORLD = 1,  // rotation around gravity, exact but needs a good gravity
+    GYRO_PLAYER = 2, // yaw from local yaw & roll, robust to tilt and noise
+};
+
+// yaw of player space may exceed world yaw by this factor, up to local yaw
+#define GYRO_PLAYER_YAW_RELAX (1.41f)
+
+bool parse_gyro_space(const std::string &text, GyroSpace &space);
+const char *gyro_space_name(GyroSpace space);
+
+/*
+gyro in dps and gravity (pointing down) in device axes -> yaw/pitch in dps
+*/
+inline void to_gyro_space(GyroSpace space,
+                          float gyro_x, float gyro_y, float gyro_z,
+                          float grav_x, float grav_y, float grav_z,
+                          float &yaw, float &pitch)
+{
+    yaw = gyro_x;
+    pitch = gyro_y;
+    float grav_norm = sqrtf(grav_x * grav_x + grav_y * grav_y + grav_z * grav_z);
+    if (space == GYRO_LOCAL || grav_norm == 0)
+        return;
+    grav_x /= grav_norm;
+    grav_y /= grav_norm;
+    grav_z /= grav_norm;
+
+    if (space == GYRO_PLAYER)
+    {
+        // world yaw gives the direction, local yaw & roll the magnitude
+        float world_yaw = -(grav_x * gyro_x + grav_z * gyro_z);
+        float local_yaw = sqrtf(gyro_x * gyro_x + gyro_z * gyro_z);
+        yaw = copysignf(fminf(fabsf(world_yaw) * GYRO_PLAYER_YAW_RELAX, local_yaw), world_yaw);
+        return;
+    }
+
+    // world: yaw around up, pitch around the pitch axis projected onto the
+    // horizontal plane
+    yaw = -(grav_x * gyro_x + grav_y * gyro_y + grav_z * gyro_z);
+    float axis_x = -grav_x * grav_y;
+    float axis_y = 1 - grav_y * grav_y;
+    float axis_z = -grav_z * grav_y;
+    float axis_norm = sqrtf(axis_x * axis_x + axis_y * axis_y + axis_z * axis_z);
+    if (axis_norm > 0)
+        pitch = (gyro_x * axis_x + gyro_y * axis_y + gyro_z * axis_z) / axis_norm;
+}
+
+#endif
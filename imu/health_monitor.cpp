@@ -0,0 +1,137 @@
+#include "health_monitor.h"
+#include <time.h>
+#include <algorithm>
+
+void HealthMonitor::restart(const BackendHealth &health)
+{
+    auto now = std::chrono::steady_clock::now();
+    last = health;
+    error_streak = stall_streak = same_streak = 0;
+    last_good = now;
+    grace_until = now + std::chrono::milliseconds(HEALTH_GRACE_MS);
+}
+
+static int64_t clock_ns(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+CLOCK_MONOTONIC stops while the system is suspended, CLOCK_BOOTTIME does
+not, the difference only grows across a suspend
+*/
+bool HealthMonitor::resumed()
+{
+    auto now = clock_ns(CLOCK_BOOTTIME) - clock_ns(CLOCK_MONOTONIC);
+    bool jumped = suspended >= 0 && now - suspended > HEALTH_RESUME_MS * 1000000LL;
+    suspended = now;
+    return jumped;
+}
+
+static bool same_reading(const ImuReading &a, const ImuReading &b)
+{
+    return a.gyro_x == b.gyro_x && a.gyro_y == b.gyro_y && a.gyro_z == b.gyro_z &&
+           a.accel_x == b.accel_x && a.accel_y == b.accel_y && a.accel_z == b.accel_z;
+}
+
+/*
+streaks of failed reads, of reads without a new sample while the backend
+saw its clock stand still and of identical readings. An issue is only
+reported once its streak is long enough and not while backing off. A
+resume or a reset sensor clock is reported right away, the sensor has to
+be checked before its readings can be trusted.
+*/
+HealthIssue HealthMonitor::check(const BackendHealth &health, const ImuReading *readings, size_t count)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (resumed())
+    {
+        resumes++;
+        last = health;
+        error_streak = stall_streak = same_streak = 0;
+        return HEALTH_RESUMED;
+    }
+    auto errors = health.bus_errors - last.bus_errors;
+    bus_errors += errors;
+    overflows += health.overflows - last.overflows;
+    auto reset = health.resets != last.resets;
+    resets += health.resets - last.resets;
+    error_streak = errors > 0 ? error_streak + 1 : 0;
+    if (count > 0)
+        stall_streak = 0;
+    else if (health.stalls != last.stalls && now >= grace_until)
+        stall_streak++;
+    last = health;
+    for (size_t i = 0; i < count; i++)
+    {
+        same_streak = same_reading(readings[i], previous) ? same_streak + 1 : 0;
+        previous = readings[i];
+    }
+
+    auto issue = HEALTH_OK;
+    if (reset)
+    {
+        error_streak = stall_streak = same_streak = 0;
+        return HEALTH_RESET;
+    }
+    if (error_streak >= HEALTH_ERROR_STREAK)
+        issue = HEALTH_BUS_ERRORS;
+    else if (stall_streak >= HEALTH_STALL_STREAK)
+        issue = HEALTH_STALLED;
+    else if (same_streak >= HEALTH_STUCK_STREAK)
+        issue = HEALTH_STUCK;
+    if (issue == HEALTH_OK)
+    {
+        if (count > 0)
+            last_good = now;
+        return HEALTH_OK;
+    }
+    if (now < backoff_until)
+        return HEALTH_OK;
+    if (issue == HEALTH_STALLED)
+        stalls++;
+    else if (issue == HEALTH_STUCK)
+        stuck++;
+    error_streak = stall_streak = same_streak = 0;
+    return issue;
+}
+
+/*
+a failed recovery backs off, a successful one records the outage and
+gives the sensors the start-up grace period again
+*/
+void HealthMonitor::recovered(bool ok, const BackendHealth &health)
+{
+    auto now = std::chrono::steady_clock::now();
+    bus_errors += health.bus_errors - last.bus_errors;
+    last = health;
+    if (!ok)
+    {
+        failed_recoveries++;
+        backoff_until = now + std::chrono::milliseconds(HEALTH_BACKOFF_MS);
+        return;
+    }
+    recoveries++;
+    auto outage = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_good).count();
+    last_outage_ms = outage;
+    max_outage_ms = std::max<uint32_t>(max_outage_ms, outage);
+    grace_until = now + std::chrono::milliseconds(HEALTH_GRACE_MS);
+}
+
+ImuHealth HealthMonitor::getStats() const
+{
+    ImuHealth stats;
+    stats.bus_errors = bus_errors;
+    stats.stalls = stalls;
+    stats.stuck = stuck;
+    stats.overflows = overflows;
+    stats.resets = resets;
+    stats.resumes = resumes;
+    stats.recoveries = recoveries;
+    stats.failed_recoveries = failed_recoveries;
+    stats.last_outage_ms = last_outage_ms;
+    stats.max_outage_ms = max_outage_ms;
+    return stats;
+}
@@ -0,0 +1,80 @@
+#ifndef HEALTH_MONITOR_HEADER
+#define HEALTH_MONITOR_HEADER
+#include "imu_backend.h"
+#include <atomic>
+#include <chrono>
+
+// consecutive reads with failed transfers, or without the sensor's clock
+// moving, before the backend is recovered
+#define HEALTH_ERROR_STREAK (2)
+#define HEALTH_STALL_STREAK (3)
+// a working gyro never repeats a reading this often, the data froze
+#define HEALTH_STUCK_STREAK (50)
+// stalls are not counted this long after the sensors were powered up
+#define HEALTH_GRACE_MS (100)
+// wait after a failed recovery before the next one
+#define HEALTH_BACKOFF_MS (1000)
+// CLOCK_BOOTTIME running ahead of CLOCK_MONOTONIC by more than this since
+// the last read means the system was suspended
+#define HEALTH_RESUME_MS (100)
+
+enum HealthIssue
+{
+    HEALTH_OK,
+    HEALTH_BUS_ERRORS,
+    HEALTH_STALLED,
+    HEALTH_STUCK,
+    HEALTH_RESET,   // the sensor's clock started over
+    HEALTH_RESUMED, // back from system suspend, the sensor may have lost power
+};
+
+// incidents since start, outages from the last good reading until recovered
+struct ImuHealth
+{
+    uint64_t bus_errors = 0; // failed transfers
+    uint64_t stalls = 0;
+    uint64_t stuck = 0;
+    uint64_t overflows = 0; // FIFO overflows
+    uint64_t resets = 0;
+    uint64_t resumes = 0;
+    uint64_t recoveries = 0;
+    uint64_t failed_recoveries = 0;
+    uint32_t last_outage_ms = 0;
+    uint32_t max_outage_ms = 0;
+};
+
+/*
+Watches the backend's reads for a sensor that stopped working: transfers
+failing, sensortime standing still or starting over, the same reading
+over and over, and the system coming back from suspend.
+check() runs after every read on the sampling thread, which recovers the
+backend when it reports an issue. The stats are readable from any thread.
+*/
+class HealthMonitor
+{
+private:
+    BackendHealth last;
+    uint32_t error_streak = 0, stall_streak = 0, same_streak = 0;
+    ImuReading previous = {};
+    std::chrono::steady_clock::time_point last_good, grace_until, backoff_until;
+    // ns the system spent suspended, as of the last check
+    int64_t suspended = -1;
+
+    std::atomic<uint64_t> bus_errors = 0, stalls = 0, stuck = 0, overflows = 0, resets = 0, resumes = 0;
+    std::atomic<uint64_t> recoveries = 0, failed_recoveries = 0;
+    std::atomic<uint32_t> last_outage_ms = 0, max_outage_ms = 0;
+
+public:
+    // the sensors were (re)started, counting starts from the backend's
+    // counters now
+    void restart(const BackendHealth &health);
+    HealthIssue check(const BackendHealth &health, const ImuReading *readings, size_t count);
+    void recovered(bool ok, const BackendHealth &health);
+    // when the last reading before an issue was taken
+    std::chrono::steady_clock::time_point lastGood() const { return last_good; };
+    // true once after the system was suspended since the last call
+    bool resumed();
+    ImuHealth getStats() const;
+};
+
+#endif
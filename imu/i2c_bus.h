@@ -0,0 +1,169 @@
+#ifndef I2C_BUS_HEADER
+#define I2C_BUS_HEADER
+extern "C" {
+    #include <linux/i2c.h>
+    #include <linux/i2c-dev.h>
+    #include <i2c/smbus.h>
+}
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+
+#define I2C_BUS_PATH "/dev/i2c-1"
+// smbus block transfers carry at most 32 bytes
+#define I2C_BLOCK_MAX (32)
+// i2c-dev refuses longer messages
+#define I2C_MSG_MAX (8192)
+
+/*
+One I2C client kept open for the sampler's hot path. Reads are a single
+block transfer when the adapter supports it, byte by byte otherwise.
+Longer reads and all writes go out as one plain I2C message, used for
+FIFO bursts and the BMI26x config upload. Register reads and runs of
+register writes fall back to SMBus blocks on adapters without plain I2C.
+*/
+class I2cBus
+{
+private:
+    int fd = -1;
+    std::string path;
+    uint8_t addr = 0;
+    bool block_read = false;
+    bool block_write = false;
+    bool plain_i2c = false;
+
+public:
+    I2cBus() = default;
+    I2cBus(const I2cBus &) = delete;
+    ~I2cBus()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool open(const char *path, uint8_t addr)
+    {
+        this->path = path;
+        this->addr = addr;
+        fd = ::open(path, O_RDWR);
+        if (fd < 0 || ioctl(fd, I2C_SLAVE, addr) < 0)
+            return false;
+        unsigned long funcs = 0;
+        if (ioctl(fd, I2C_FUNCS, &funcs) == 0)
+        {
+            block_read = funcs & I2C_FUNC_SMBUS_READ_I2C_BLOCK;
+            block_write = funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK;
+            plain_i2c = funcs & I2C_FUNC_I2C;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return fd >= 0; };
+
+    // a fresh client on the same bus, after the adapter was reset
+    bool reopen()
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+        return open(std::string(path).c_str(), addr);
+    }
+
+    /*
+    a register write then a read with a repeated start, the chip keeps
+    incrementing the address, except for trapped ones like FIFO data
+    */
+    inline bool read(uint8_t reg, uint8_t *data, uint16_t len)
+    {
+        if (block_read && len <= I2C_BLOCK_MAX)
+            return i2c_smbus_read_i2c_block_data(fd, reg, len, data) == len;
+        if (plain_i2c && len <= I2C_MSG_MAX)
+        {
+            i2c_msg msgs[2] = {
+                {addr, 0, 1, &reg},
+                {addr, I2C_M_RD, len, data},
+            };
+            i2c_rdwr_ioctl_data transfer = {msgs, 2};
+            return ioctl(fd, I2C_RDWR, &transfer) == 2;
+        }
+        if (block_read)
+        {
+            for (uint16_t done = 0; done < len; done += I2C_BLOCK_MAX)
+            {
+                uint16_t chunk = std::min<uint16_t>(len - done, I2C_BLOCK_MAX);
+                if (i2c_smbus_read_i2c_block_data(fd, reg + done, chunk, data + done) != chunk)
+                    return false;
+            }
+            return true;
+        }
+        for (uint16_t i = 0; i < len; i++)
+        {
+            auto value = i2c_smbus_read_byte_data(fd, reg + i);
+            if (value < 0)
+                return false;
+            data[i] = value;
+        }
+        return true;
+    }
+
+    /*
+    len bytes from one register that does not increment, like FIFO data:
+    one message, smbus blocks or single bytes, all from the same address
+    */
+    bool readFifo(uint8_t reg, uint8_t *data, uint16_t len)
+    {
+        if (plain_i2c && len <= I2C_MSG_MAX)
+            return read(reg, data, len);
+        for (uint16_t done = 0; done < len;)
+        {
+            uint16_t chunk = std::min<uint16_t>(len - done, block_read ? I2C_BLOCK_MAX : 1);
+            if (block_read && i2c_smbus_read_i2c_block_data(fd, reg, chunk, data + done) != chunk)
+                return false;
+            if (!block_read)
+            {
+                auto value = i2c_smbus_read_byte_data(fd, reg);
+                if (value < 0)
+                    return false;
+                data[done] = value;
+            }
+            done += chunk;
+        }
+        return true;
+    }
+
+    bool write(uint8_t reg, const uint8_t *data, uint16_t len)
+    {
+        uint8_t buf[I2C_MSG_MAX];
+        if (len >= I2C_MSG_MAX)
+            return false;
+        buf[0] = reg;
+        memcpy(buf + 1, data, len);
+        return ::write(fd, buf, len + 1) == len + 1;
+    }
+
+    /*
+    a run of registers the chip increments through: one message, SMBus
+    blocks or single bytes at the following addresses
+    */
+    bool writeRegs(uint8_t reg, const uint8_t *data, uint16_t len)
+    {
+        if (plain_i2c)
+            return write(reg, data, len);
+        for (uint16_t done = 0; done < len;)
+        {
+            uint16_t chunk = std::min<uint16_t>(len - done, block_write ? I2C_BLOCK_MAX : 1);
+            if (block_write && i2c_smbus_write_i2c_block_data(fd, reg + done, chunk, data + done) != 0)
+                return false;
+            if (!block_write && i2c_smbus_write_byte_data(fd, reg + done, data[done]) != 0)
+                return false;
+            done += chunk;
+        }
+        return true;
+    }
+};
+
+#endif
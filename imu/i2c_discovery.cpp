@@ -0,0 +1,134 @@
+#include "i2c_discovery.h"
+#include "bmi26x_backend.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <vector>
+
+static bool is_imu_chip(uint8_t chip_id)
+{
+    return chip_id == BMI160_CHIP_ID || chip_id == BMI260_CHIP_ID || chip_id == BMI270_CHIP_ID;
+}
+
+// graphics drivers register their DDC and DP aux channels as adapters
+static bool is_display_adapter(const std::string &name)
+{
+    for (auto tag : {"AUX", "aux", "DDC", "gmbus", "AMDGPU", "i915", "nouveau", "radeon"})
+    {
+        if (name.find(tag) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+/*
+chip id read at one address, the same register and value bmi160_init
+checks. 0 if the adapter can not do byte reads, the address is claimed
+by a kernel driver or nothing acknowledges.
+*/
+static uint8_t probe(int fd, uint8_t addr)
+{
+    if (ioctl(fd, I2C_SLAVE, addr) < 0)
+        return 0;
+    auto value = i2c_smbus_read_byte_data(fd, BMI160_CHIP_ID_ADDR);
+    return value < 0 ? 0 : value;
+}
+
+static I2cLocation probe_adapter(const std::string &bus, const std::vector<uint8_t> &addrs)
+{
+    I2cLocation location;
+    int fd = open(bus.c_str(), O_RDWR);
+    if (fd < 0)
+        return location;
+    unsigned long funcs = 0;
+    if (ioctl(fd, I2C_FUNCS, &funcs) == 0 && (funcs & I2C_FUNC_SMBUS_READ_BYTE_DATA))
+    {
+        ioctl(fd, I2C_TIMEOUT, I2C_PROBE_TIMEOUT);
+        ioctl(fd, I2C_RETRIES, I2C_PROBE_RETRIES);
+        for (auto addr : addrs)
+        {
+            auto chip_id = probe(fd, addr);
+            if (is_imu_chip(chip_id))
+            {
+                location = {bus, addr, chip_id};
+                break;
+            }
+        }
+        ioctl(fd, I2C_TIMEOUT, I2C_DEFAULT_TIMEOUT);
+        ioctl(fd, I2C_RETRIES, I2C_DEFAULT_RETRIES);
+    }
+    close(fd);
+    return location;
+}
+
+static bool load_cache(I2cLocation &location)
+{
+    std::ifstream file(I2C_DISCOVERY_CACHE_PATH);
+    int addr;
+    if (!(file >> location.bus >> addr))
+        return false;
+    location.addr = addr;
+    return true;
+}
+
+static void save_cache(const I2cLocation &location)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(I2C_DISCOVERY_CACHE_PATH).parent_path(), error);
+    std::ofstream file(I2C_DISCOVERY_CACHE_PATH);
+    file << location.bus << " " << +location.addr << "\n";
+}
+
+bool discover_imu(I2cLocation &location)
+{
+    I2cLocation cached;
+    if (load_cache(cached))
+    {
+        auto found = probe_adapter(cached.bus, {cached.addr});
+        if (!found.bus.empty())
+        {
+            location = found;
+            return true;
+        }
+    }
+
+    // adapter number order, so the pick does not depend on thread timing
+    std::vector<std::pair<int, std::string>> buses;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(I2C_SYSFS_ROOT, error))
+    {
+        auto id = entry.path().filename().string();
+        std::ifstream name_file(entry.path() / "name");
+        std::string name;
+        std::getline(name_file, name);
+        if (id.rfind("i2c-", 0) != 0 || is_display_adapter(name))
+            continue;
+        buses.emplace_back(atoi(id.c_str() + 4), I2C_DEV_ROOT + id);
+    }
+    std::sort(buses.begin(), buses.end());
+
+    std::vector<std::future<I2cLocation>> probes;
+    for (const auto &bus : buses)
+        probes.push_back(std::async(std::launch::async, probe_adapter, bus.second,
+                                    std::vector<uint8_t>{IMU_I2C_ADDR_LOW, IMU_I2C_ADDR_HIGH}));
+    bool found = false;
+    for (auto &probe : probes)
+    {
+        auto result = probe.get();
+        if (!found && !result.bus.empty())
+        {
+            location = result;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        std::cout << "imu discovery err! no BMI160/BMI26x on " << buses.size() << " adapters" << std::endl;
+        return false;
+    }
+    std::cout << "imu found on " << location.bus << " at 0x" << std::hex << +location.addr << std::dec << std::endl;
+    save_cache(location);
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef I2C_DISCOVERY_HEADER
+#define I2C_DISCOVERY_HEADER
+#include <stdint.h>
+#include <string>
+
+// SDO low / high
+#define IMU_I2C_ADDR_LOW (0x68)
+#define IMU_I2C_ADDR_HIGH (0x69)
+#define I2C_DEV_ROOT "/dev/"
+#define I2C_SYSFS_ROOT "/sys/class/i2c-dev/"
+// per transfer, in 10ms units, and no retries while probing
+#define I2C_PROBE_TIMEOUT (2)
+#define I2C_PROBE_RETRIES (0)
+// the settings are the adapter's, not the fd's, and i2c-dev can not read
+// them back, the kernel defaults (1s, no retries) are set again after
+#define I2C_DEFAULT_TIMEOUT (100)
+#define I2C_DEFAULT_RETRIES (0)
+// where the IMU was found, checked first on the next start
+#define I2C_DISCOVERY_CACHE_PATH "/var/lib/oxp_gyro_key_mapper/imu_location"
+
+struct I2cLocation
+{
+    std::string bus;
+    uint8_t addr = 0;
+    uint8_t chip_id = 0;
+};
+
+/*
+Find a BMI160 or BMI26x on any i2c-dev adapter. The cached location is
+checked first, otherwise all adapters are probed at the same time, each
+at both addresses with short timeouts, so a dead or slow bus costs its
+timeout once instead of stalling the rest. Display adapters (DDC and
+DP aux) are never touched. Returns false if nothing answers with a
+known chip id.
+*/
+bool discover_imu(I2cLocation &location);
+
+#endif
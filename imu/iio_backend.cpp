@@ -0,0 +1,283 @@
+#include "iio_backend.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+static const char *channel_names[7] = {
+    "in_accel_x", "in_accel_y", "in_accel_z",
+    "in_anglvel_x", "in_anglvel_y", "in_anglvel_z",
+    "in_timestamp"};
+
+static bool read_attr(const std::string &path, std::string &value)
+{
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, value));
+}
+
+static bool write_attr(const std::string &path, const std::string &value)
+{
+    std::ofstream file(path);
+    file << value;
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+/*
+"le:s16/16>>0" -> endianness, sign, valid bits / storage bits >> shift
+*/
+static bool parse_type(const std::string &text, IioChannel &channel)
+{
+    char endian[3] = {};
+    char sign;
+    unsigned storage;
+    if (sscanf(text.c_str(), "%2s:%c%u/%u>>%u", endian, &sign, &channel.bits, &storage, &channel.shift) != 5 ||
+        (storage != 8 && storage != 16 && storage != 32 && storage != 64))
+        return false;
+    channel.big_endian = strcmp(endian, "be") == 0;
+    channel.is_signed = sign == 's';
+    channel.bytes = storage / 8;
+    return true;
+}
+
+static bool parse_index(const std::string &text, int &index)
+{
+    auto end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, index);
+    return result.ec == std::errc() && result.ptr == end && index >= 0;
+}
+
+static int64_t unpack(const uint8_t *scan, const IioChannel &channel)
+{
+    uint64_t value = 0;
+    for (unsigned i = 0; i < channel.bytes; i++)
+    {
+        unsigned byte = channel.big_endian ? i : channel.bytes - 1 - i;
+        value = value << 8 | scan[channel.offset + byte];
+    }
+    value >>= channel.shift;
+    if (channel.bits < 64)
+    {
+        value &= (UINT64_C(1) << channel.bits) - 1;
+        if (channel.is_signed && (value >> (channel.bits - 1)) & 1)
+            value |= ~((UINT64_C(1) << channel.bits) - 1);
+    }
+    return static_cast<int64_t>(value);
+}
+
+IioBackend::IioBackend(const std::string &device_dir, int rate) : device_dir(device_dir), rate(rate)
+{
+    if (!device_dir.empty() && !open())
+        std::cout << "iio device err!" << std::endl;
+}
+
+IioBackend::~IioBackend()
+{
+    if (fd < 0)
+        return;
+    setEnabled(false);
+    close(fd);
+}
+
+std::string IioBackend::find(const std::string &name)
+{
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(IIO_SYSFS_ROOT, error))
+    {
+        std::string dev_name;
+        if (entry.path().filename().string().rfind("iio:device", 0) == 0 &&
+            read_attr(entry.path() / "name", dev_name) && dev_name == name)
+            return entry.path().string();
+    }
+    return "";
+}
+
+/*
+enable only our channels and compute where they are in a scan, elements
+are ordered by index and aligned to their own size, the scan to the
+largest one
+*/
+bool IioBackend::setupChannels()
+{
+    auto scan_dir = std::filesystem::path(device_dir) / "scan_elements";
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(scan_dir, error))
+    {
+        auto file = entry.path().filename().string();
+        if (file.size() > 3 && file.compare(file.size() - 3, 3, "_en") == 0)
+        {
+            auto channel = file.substr(0, file.size() - 3);
+            bool wanted = std::find(std::begin(channel_names), std::end(channel_names), channel) != std::end(channel_names);
+            write_attr(entry.path(), wanted ? "1" : "0");
+        }
+    }
+    if (error)
+        return false;
+
+    std::vector<std::pair<int, int>> order;
+    for (int i = 0; i < 7; i++)
+    {
+        std::string index_text, type;
+        int index;
+        if (!read_attr(scan_dir / (std::string(channel_names[i]) + "_index"), index_text) ||
+            !parse_index(index_text, index) ||
+            !read_attr(scan_dir / (std::string(channel_names[i]) + "_type"), type) ||
+            !parse_type(type, channels[i]))
+        {
+            std::cout << "iio channel " << channel_names[i] << " err!" << std::endl;
+            return false;
+        }
+        order.push_back({index, i});
+    }
+    std::sort(order.begin(), order.end());
+    size_t offset = 0;
+    unsigned align = 1;
+    for (const auto &element : order)
+    {
+        auto &channel = channels[element.second];
+        offset = (offset + channel.bytes - 1) / channel.bytes * channel.bytes;
+        channel.offset = offset;
+        offset += channel.bytes;
+        align = std::max(align, channel.bytes);
+    }
+    scan_size = (offset + align - 1) / align * align;
+    buf.resize(scan_size * IIO_BUFFER_LENGTH);
+    buf_used = 0;
+
+    // m/s^2 and rad/s per lsb
+    std::string accel, gyro;
+    if (!read_attr(device_dir + "/in_accel_scale", accel) || !read_attr(device_dir + "/in_anglvel_scale", gyro))
+        return false;
+    accel_scale = std::stof(accel) / GRAVITY_EARTH;
+    gyro_scale = std::stof(gyro) * 180 / M_PI;
+    return true;
+}
+
+/*
+the driver's own data ready trigger if it has one, otherwise an hrtimer
+trigger at the sample rate
+*/
+bool IioBackend::setupTrigger()
+{
+    std::error_code error;
+    std::string dev_name;
+    read_attr(device_dir + "/name", dev_name);
+    std::string hrtimer_dir;
+    for (int pass = 0; pass < 2 && trigger_name.empty(); pass++)
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(IIO_SYSFS_ROOT, error))
+        {
+            std::string name;
+            if (entry.path().filename().string().rfind("trigger", 0) != 0 || !read_attr(entry.path() / "name", name))
+                continue;
+            if (pass == 0 && !dev_name.empty() && name.rfind(dev_name, 0) == 0)
+                trigger_name = name;
+            if (pass == 1 && name == IIO_HRTIMER_NAME)
+            {
+                trigger_name = name;
+                write_attr(entry.path() / "sampling_frequency", std::to_string(rate));
+            }
+        }
+        if (pass == 0 && trigger_name.empty())
+            std::filesystem::create_directories(std::string(IIO_HRTIMER_ROOT) + "/" + IIO_HRTIMER_NAME, error);
+    }
+    if (trigger_name.empty())
+        return false;
+    return write_attr(device_dir + "/trigger/current_trigger", trigger_name);
+}
+
+bool IioBackend::open()
+{
+    // stop buffering before touching the channels, a no-op when already off
+    write_attr(device_dir + "/buffer/enable", "0");
+    if (!setupChannels())
+        return false;
+
+    auto recording = device_dir + "/" + IIO_RECORDING_NAME;
+    if (std::filesystem::exists(recording))
+    {
+        fd = ::open(recording.c_str(), O_RDONLY | O_NONBLOCK);
+        return fd >= 0;
+    }
+
+    write_attr(device_dir + "/in_accel_sampling_frequency", std::to_string(rate));
+    write_attr(device_dir + "/in_anglvel_sampling_frequency", std::to_string(rate));
+    write_attr(device_dir + "/current_timestamp_clock", "monotonic");
+    if (!setupTrigger())
+    {
+        std::cout << "iio trigger err!" << std::endl;
+        return false;
+    }
+    write_attr(device_dir + "/buffer/length", std::to_string(IIO_BUFFER_LENGTH));
+    write_attr(device_dir + "/buffer/watermark", std::to_string(IIO_WATERMARK));
+    auto dev_path = "/dev/" + std::filesystem::path(device_dir).filename().string();
+    fd = ::open(dev_path.c_str(), O_RDONLY | O_NONBLOCK);
+    return fd >= 0;
+}
+
+bool IioBackend::setEnabled(bool on)
+{
+    buf_used = 0;
+    return write_attr(device_dir + "/buffer/enable", on ? "1" : "0");
+}
+
+bool IioBackend::recover()
+{
+    return setEnabled(false) && setEnabled(true);
+}
+
+size_t IioBackend::read(ImuReading *readings, size_t max)
+{
+    pollfd pfd = {fd, POLLIN, 0};
+    if (max == 0)
+        return 0;
+    auto ready = poll(&pfd, 1, IIO_POLL_MS);
+    if (ready <= 0)
+    {
+        if (ready == 0)
+            health.stalls++;
+        return 0;
+    }
+    auto want = std::min(max * scan_size, buf.size()) - buf_used;
+    auto ret = ::read(fd, buf.data() + buf_used, want);
+    if (ret < 0 && errno != EAGAIN)
+    {
+        health.bus_errors++;
+        return 0;
+    }
+    if (ret <= 0)
+    {
+        // a replayed recording at its end
+        std::this_thread::sleep_for(std::chrono::microseconds(getSamplePeriodUs()));
+        return 0;
+    }
+    buf_used += ret;
+
+    size_t count = buf_used / scan_size;
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *scan = buf.data() + i * scan_size;
+        auto &reading = readings[i];
+        reading.accel_x = unpack(scan, channels[0]) * accel_scale;
+        reading.accel_y = unpack(scan, channels[1]) * accel_scale;
+        reading.accel_z = unpack(scan, channels[2]) * accel_scale;
+        reading.gyro_x = unpack(scan, channels[3]) * gyro_scale;
+        reading.gyro_y = unpack(scan, channels[4]) * gyro_scale;
+        reading.gyro_z = unpack(scan, channels[5]) * gyro_scale;
+        reading.timestamp = unpack(scan, channels[6]);
+    }
+    // keep a partial scan for the next read
+    auto rest = buf_used - count * scan_size;
+    memmove(buf.data(), buf.data() + count * scan_size, rest);
+    buf_used = rest;
+    return count;
+}
@@ -0,0 +1,89 @@
+#ifndef IIO_BACKEND_HEADER
+#define IIO_BACKEND_HEADER
+#include "imu_backend.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define IIO_SYSFS_ROOT "/sys/bus/iio/devices"
+#define IIO_HRTIMER_ROOT "/sys/kernel/config/iio/triggers/hrtimer"
+#define IIO_HRTIMER_NAME "oxp_gyro_key_mapper"
+// name of the in-kernel driver's iio device
+#define IIO_DEVICE_NAME "bmi160"
+// samples per second, samples the kernel buffers and wakes us up for
+#define IIO_SAMPLE_RATE (100)
+#define IIO_BUFFER_LENGTH (128)
+#define IIO_WATERMARK (4)
+// longest wait for the kernel buffer
+#define IIO_POLL_MS (100)
+// raw scans read in place of the char device when replaying a recording
+#define IIO_RECORDING_NAME "recording"
+
+// layout of one scan element, see sysfs scan_elements/*_type
+struct IioChannel
+{
+    size_t offset = 0;
+    unsigned bytes = 0;
+    unsigned bits = 0;
+    unsigned shift = 0;
+    bool is_signed = false;
+    bool big_endian = false;
+};
+
+/*
+Reads accel, gyro and timestamp through the iio buffer of the in-kernel
+driver, which does the bus access and timestamps the samples. Setup
+only writes sysfs attributes of device_dir, so a copy of the directory
+with a "recording" file of raw scans in it replays a capture.
+*/
+class IioBackend
+{
+private:
+    std::string device_dir;
+    std::string trigger_name;
+    int fd = -1;
+    int rate = IIO_SAMPLE_RATE;
+    // accel x y z, gyro x y z, timestamp
+    IioChannel channels[7];
+    size_t scan_size = 0;
+    float accel_scale = 0, gyro_scale = 0;
+    // bytes of a partial scan from the last read
+    std::vector<uint8_t> buf;
+    size_t buf_used = 0;
+    BackendHealth health;
+
+    bool setupChannels();
+    bool setupTrigger();
+    bool open();
+    bool setEnabled(bool on);
+
+public:
+    // the kernel driver does not expose motion interrupts or temperature
+    static constexpr bool has_motion_interrupts = false;
+    // the sample rate is fixed while the buffer runs
+    static constexpr bool has_burst_capture = false;
+    static constexpr bool has_gestures = false;
+
+    IioBackend(const std::string &device_dir, int rate = IIO_SAMPLE_RATE);
+    IioBackend(const IioBackend &) = delete;
+    ~IioBackend();
+    // sysfs dir of the first device with this name, empty if there is none
+    static std::string find(const std::string &name = IIO_DEVICE_NAME);
+    bool isOpen() const { return fd >= 0; };
+    int getSamplePeriodUs() const { return 1000000 / rate; };
+    // the buffer only runs while active, the driver suspends the chip otherwise
+    void setPowerState(PowerState state) { setEnabled(state != POWER_OFF); };
+    bool readTemperature(float &celsius) { return false; };
+    bool anyMotion() { return false; };
+    bool noMotion() { return false; };
+    const BackendHealth &getHealth() const { return health; };
+    // the buffer is restarted, the driver sets the chip up again
+    bool recover();
+    size_t captureBurst(ImuReading *readings, size_t max) { return 0; };
+    uint32_t gestures() { return 0; };
+    // complete scans, waits up to IIO_POLL_MS for the buffer
+    size_t read(ImuReading *readings, size_t max);
+};
+
+#endif
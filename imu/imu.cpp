@@ -1,176 +1,603 @@
 #include "imu.h"
 
-float lsb_to_ms2(int16_t val, float g_range, uint8_t bit_width)
+IMU::IMU() : sensitivity_curve(new ResponseCurve(defaultSensitivitySpec()))
 {
-    float half_scale = (float)(1 << bit_width) / 2.0f;
+    filter = new MotionFilter();
+}
+
+IMU::~IMU()
+{
+    stop();
+};
+
+bool IMU::isBackend(const std::string &name)
+{
+    return name == "auto" || name == "i2c" || name == "bmi160" || name == "bmi26x" || name == "bmi26x-sim" ||
+           name == "iio" || name == "sim" || name == "replay";
+}
+
+// chip id register, 0 if nothing answers
+static uint8_t probe_chip_id(const ImuPlacement &placement)
+{
+    I2cBus bus;
+    uint8_t chip_id = 0;
+    if (bus.open(placement.bus.c_str(), placement.addr))
+        bus.read(BMI26X_CHIP_ID_ADDR, &chip_id, 1);
+    return chip_id;
+}
+
+/*
+auto prefers the kernel driver's iio device and falls back to the
+userspace I2C driver, i2c picks the driver by chip id. Without a bus in
+the placement the I2C drivers discover the IMU. nullptr if the backend
+can not be opened.
+*/
+IMU *IMU::create(const std::string &backend, const std::string &device, const ImuPlacement &placement)
+{
+    auto name = backend;
+    auto iio_dir = device;
+    if (name == "auto" || name == "iio")
+    {
+        if (iio_dir.empty())
+            iio_dir = IioBackend::find();
+        if (name == "auto")
+            name = iio_dir.empty() ? "i2c" : "iio";
+    }
+    auto located = placement;
+    uint8_t chip_id = 0;
+    bool i2c = name == "i2c" || name == "bmi160" || name == "bmi26x";
+    if (i2c && located.bus.empty())
+    {
+        I2cLocation location;
+        if (discover_imu(location))
+        {
+            located.bus = location.bus;
+            located.addr = location.addr;
+            chip_id = location.chip_id;
+        }
+        else
+            located.bus = I2C_BUS_PATH;
+    }
+    if (chip_id == 0 && (name == "i2c" || name == "bmi26x"))
+        chip_id = probe_chip_id(located);
+    if (name == "i2c")
+        name = chip_id == BMI260_CHIP_ID || chip_id == BMI270_CHIP_ID ? "bmi26x" : "bmi160";
+    IMU *imu = nullptr;
+    if (name == "bmi160")
+        imu = new BasicIMU<Bmi160Backend>(located.bus, located.addr);
+    else if (name == "bmi26x")
+        imu = new BasicIMU<Bmi26xBackend<I2cBus>>(bmi26x_load_config(device, chip_id), located.bus, located.addr);
+    else if (name == "bmi26x-sim")
+        imu = new BasicIMU<Bmi26xBackend<Bmi26xSimBus>>(std::vector<uint8_t>(BMI26X_CONFIG_SIZE), located.bus, located.addr);
+    else if (name == "iio")
+        imu = new BasicIMU<IioBackend>(iio_dir);
+    else if (name == "sim")
+        imu = new BasicIMU<SimBackend>();
+    else if (name == "replay")
+        imu = new BasicIMU<ReplayBackend>(device);
+    if (imu != nullptr && !imu->isOpen())
+    {
+        delete imu;
+        imu = nullptr;
+    }
+    if (imu != nullptr)
+        imu->setAxisRemap(placement.axes);
+    return imu;
+}
 
-    return GRAVITY_EARTH * val * g_range / half_scale;
+void IMU::setDemand(ImuDemand source, bool on)
+{
+    std::lock_guard<std::mutex> lock(command_lock);
+    if (on)
+        demand |= source;
+    else
+        demand &= ~source;
+    wakeup.notify_one();
 }
-float lsb_to_mg(int16_t val, float g_range, uint8_t bit_width)
+
+/*
+listeners are called on the sampling thread for every new sample,
+register them before start()
+*/
+void IMU::addListener(MotionListener listener)
 {
-    float half_scale = (float)(1 << bit_width) / 2.0f;
+    listeners.push_back(listener);
+}
 
-    return 1000.0f * val * g_range / half_scale;
+/*
+gesture listeners are called on the sampling thread too, as soon as the
+sensor reports one, register them before start()
+*/
+void IMU::addGestureListener(GestureListener listener)
+{
+    gesture_listeners.push_back(listener);
 }
 
-float lsb_to_dps(int16_t val, float g_range, uint8_t bit_width)
+/*
+tick listeners are called on the sampling thread after each read that
+delivered samples, to flush what the motion listeners batched
+*/
+void IMU::addTickListener(TickListener listener)
 {
-    float half_scale = (float)(1 << bit_width) / 2.0f;
+    tick_listeners.push_back(listener);
+}
 
-    return val * g_range / half_scale;
+void IMU::start()
+{
+    if (running)
+        return;
+    temp_model.load(TEMP_MODEL_PATH);
+    temp_model_saved = std::chrono::steady_clock::now();
+    running = true;
+    sampler = std::thread(&IMU::sampleLoop, this);
 }
 
-void read_reg(uint8_t dev_addr, uint8_t reg_addr, uint8_t *data, uint16_t len)
+void IMU::stop()
 {
-    // std::cout << "read dev_addr " << std::hex << +dev_addr << " reg_addr " << std::hex << +reg_addr << " len " << len << std::endl;
-    char filename[40];
-    sprintf(filename, "/dev/i2c-1");
-    auto file = open(filename, O_RDWR);
-    ioctl(file, I2C_SLAVE, dev_addr);
-    signed int raw_data = 0;
-    for (size_t i = 0; i < len; i++)
     {
-        raw_data = i2c_smbus_read_byte_data(file, reg_addr + i);
-        data[i] = (uint8_t)raw_data;
-        // std::cout << "read " << i << " data: " << std::bitset<8>(+raw_data) << std::endl;
+        std::lock_guard<std::mutex> lock(command_lock);
+        running = false;
+        wakeup.notify_one();
     }
-    close(file);
-};
+    if (sampler.joinable())
+        sampler.join();
+    if (temp_model_dirty && temp_model.save(TEMP_MODEL_PATH))
+        temp_model_dirty = false;
+}
 
-void write_reg(uint8_t dev_addr, uint8_t reg_addr, uint8_t *read_data, uint16_t len)
+/*
+one sampler per axis remap, picked once, so the remap is folded into
+the per-sample path
+*/
+template <ImuBackend Backend>
+void BasicIMU<Backend>::sampleLoop()
 {
-    // std::cout << "write reg_addr " << std::hex << +reg_addr << " data " << std::bitset<8>(*read_data) << " len " << len << std::endl;
-    char filename[40];
-    sprintf(filename, "/dev/i2c-1");
-    auto file = open(filename, O_RDWR);
-    ioctl(file, I2C_SLAVE, dev_addr);
-    for (size_t i = 0; i < len; i++)
+    switch (axis_remap)
     {
-        i2c_smbus_write_byte_data(file, reg_addr + i, read_data[i]);
+    case AXIS_REMAP_Z90:
+        return runSampler<AXIS_REMAP_Z90>();
+    case AXIS_REMAP_Z180:
+        return runSampler<AXIS_REMAP_Z180>();
+    case AXIS_REMAP_Z270:
+        return runSampler<AXIS_REMAP_Z270>();
+    default:
+        return runSampler<AXIS_REMAP_IDENTITY>();
     }
+}
 
-    close(file);
-};
+/*
+active: read at the backend's pace and check for no-motion every
+IMU_NO_MOTION_CHECK_MS. idle: only poll for any-motion. off: sleep until
+there is demand or a command. Backends without motion interrupts are
+never idle. Bound gestures alone keep the sensors idle, which is all the
+chip needs to detect them, and do not wake it on motion. A read the
+health monitor finds an issue with is dropped and the backend recovered.
+*/
+template <ImuBackend Backend>
+template <AxisRemapId Axes>
+void BasicIMU<Backend>::runSampler()
+{
+    auto idle_period = std::chrono::milliseconds(IMU_IDLE_POLL_MS);
+    auto no_motion_check = std::max<uint64_t>(IMU_NO_MOTION_CHECK_MS * 1000 / backend.getSamplePeriodUs(), 1);
+    uint64_t samples = 0;
+    ImuReading readings[std::max(IMU_READ_MAX, BURST_CALIBRATION_SAMPLES)];
+    MotionSample sample;
+    health.restart(backend.getHealth());
+    if constexpr (!Backend::has_burst_capture)
+        burst_target = std::clamp(BURST_CALIBRATION_WINDOW_US / backend.getSamplePeriodUs(),
+                                  BURST_CALIBRATION_MIN_SAMPLES, BURST_CALIBRATION_SAMPLES);
+    while (running)
+    {
+        if (has_commands)
+            runCommands();
+        sensitivity_curve.quiesce();
+
+        // a calibration burst samples whatever the demand, the sensors go
+        // back to the state they were in once it is done
+        if (burst_calibrating && power_state != POWER_ACTIVE)
+        {
+            burst_return = static_cast<PowerState>(power_state.load());
+            setPowerState(POWER_ACTIVE);
+        }
+        else if (!burst_calibrating && burst_return != POWER_ACTIVE)
+        {
+            setPowerState(burst_return);
+            burst_return = POWER_ACTIVE;
+        }
+
+        auto wanted = servedDemand();
+        if (wanted == 0 && !burst_calibrating)
+        {
+            setPowerState(POWER_OFF);
+            std::unique_lock<std::mutex> lock(command_lock);
+            wakeup.wait(lock, [this]()
+                        { return !running || servedDemand() != 0 || has_commands; });
+            continue;
+        }
+        bool gestures_only = Backend::has_motion_interrupts && wanted == IMU_DEMAND_GESTURES && !burst_calibrating;
+        if (power_state == POWER_OFF || (gestures_only && power_state == POWER_ACTIVE))
+            setPowerState(gestures_only ? POWER_IDLE : POWER_ACTIVE);
+
+        if constexpr (Backend::has_motion_interrupts)
+        {
+            if (power_state == POWER_IDLE)
+            {
+                // polled for the gestures it picks up even if motion is ignored
+                if (backend.anyMotion() && !gestures_only)
+                    setPowerState(POWER_ACTIVE);
+                else
+                    std::this_thread::sleep_for(idle_period);
+                notifyGestures();
+                continue;
+            }
+        }
+
+        size_t count = 0;
+        if constexpr (Backend::has_burst_capture)
+        {
+            if (burst_pending)
+                count = backend.captureBurst(readings, burst_target);
+        }
+        burst_pending = false;
+        if (count == 0)
+            count = backend.read(readings, IMU_READ_MAX);
+        auto issue = health.check(backend.getHealth(), readings, count);
+        if (issue != HEALTH_OK)
+        {
+            recover(issue);
+            continue;
+        }
+        if (count > 0 && timestamp - temp_timestamp >= TEMP_READ_INTERVAL_S)
+        {
+            temp_timestamp = timestamp;
+            float celsius;
+            if (backend.readTemperature(celsius))
+                setTemperature(celsius);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            remap_reading<Axes>(readings[i]);
+            if (burst_calibrating)
+                calibrateBurst(readings[i]);
+            if (!ingest(readings[i], sample))
+                continue;
+            for (auto &listener : listeners)
+                listener(sample);
+        }
+        if (count > 0)
+        {
+            for (auto &listener : tick_listeners)
+                listener();
+        }
+        notifyGestures();
+
+        if constexpr (Backend::has_motion_interrupts)
+        {
+            samples += count;
+            if (samples >= no_motion_check)
+            {
+                samples = 0;
+                if (!burst_calibrating && backend.noMotion())
+                    setPowerState(POWER_IDLE);
+            }
+        }
+        saveTempModel();
+    }
+}
 
-void delay_ms(uint32_t period)
+template <ImuBackend Backend>
+void BasicIMU<Backend>::setPowerState(PowerState state)
 {
-    // sleep(0.01*period);
-    usleep(1000 * period);
+    if (state == power_state)
+        return;
+    backend.setPowerState(state);
+    if (power_state == POWER_ACTIVE)
+        paused_at = std::chrono::steady_clock::now();
+    if (state == POWER_ACTIVE)
+    {
+        resync = true;
+        health.restart(backend.getHealth());
+    }
+    power_state = state;
 }
 
-IMU::IMU()
+/*
+the outage is handled like a pause: the filter keeps its calibration and
+the clock resyncs on the first reading after it
+*/
+template <ImuBackend Backend>
+void BasicIMU<Backend>::recover(HealthIssue issue)
 {
-    sensor = new bmi160_dev();
-    filter = new GamepadMotion();
+    static const char *issue_names[] = {"ok", "bus", "stalled", "stuck", "reset", "resumed"};
+    if (issue == HEALTH_RESUMED)
+        std::cout << "imu resumed, checking the sensor" << std::endl;
+    else
+        std::cout << "imu " << issue_names[issue] << " err! recovering" << std::endl;
+    bool ok = backend.recover();
+    if (!ok)
+        std::cout << "imu recovery err!" << std::endl;
+    health.recovered(ok, backend.getHealth());
+    if (!resync)
+    {
+        paused_at = health.lastGood();
+        resync = true;
+    }
+}
 
-    // init IMU
-    sensor->id = 0x68;
-    sensor->intf = BMI160_I2C_INTF;
-    sensor->read = (bmi160_read_fptr_t)read_reg;
-    sensor->write = (bmi160_write_fptr_t)write_reg;
-    sensor->delay_ms = (bmi160_delay_fptr_t)delay_ms;
-    auto ret = bmi160_init(sensor);
+template <ImuBackend Backend>
+void BasicIMU<Backend>::notifyGestures()
+{
+    if constexpr (Backend::has_gestures)
+    {
+        auto gestures = backend.gestures();
+        if (gestures == 0)
+            return;
+        for (auto &listener : gesture_listeners)
+            listener(gestures);
+    }
+}
 
-    // power on
-    sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
-    sensor->gyro_cfg.power = BMI160_GYRO_NORMAL_MODE;
-    bmi160_set_power_mode(sensor);
-    sleep(1);
+template class BasicIMU<Bmi160Backend>;
+template class BasicIMU<Bmi26xBackend<I2cBus>>;
+template class BasicIMU<Bmi26xBackend<Bmi26xSimBus>>;
+template class BasicIMU<IioBackend>;
+template class BasicIMU<SimBackend>;
+template class BasicIMU<ReplayBackend>;
 
-    bmi160_get_power_mode(sensor);
-    
-    // Fast offset compensation
-    bmi160_foc_conf conf;
-    conf.acc_off_en = BMI160_ENABLE;
-    conf.gyro_off_en = BMI160_ENABLE;
-    conf.foc_acc_x = BMI160_FOC_ACCEL_NEGATIVE_G;
-    conf.foc_acc_y = BMI160_FOC_ACCEL_0G;
-    conf.foc_acc_x = BMI160_FOC_ACCEL_0G;
-    conf.foc_gyr_en = BMI160_ENABLE;
+void IMU::post(std::function<void()> command)
+{
+    std::lock_guard<std::mutex> lock(command_lock);
+    commands.push_back(command);
+    has_commands = true;
+    wakeup.notify_one();
+}
 
-    auto foc_status = bmi160_start_foc(&conf, &offsets, sensor);
+void IMU::runCommands()
+{
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(command_lock);
+        pending.swap(commands);
+        has_commands = false;
+    }
+    for (auto &command : pending)
+        command();
+}
 
-    bmi160_set_offsets(&conf, &offsets, sensor);
+void IMU::resetCalibration()
+{
+    post([this]()
+         {
+             filter->ResetContinuousCalibration();
+             temp_model.clear();
+             temp_bias_x = temp_bias_y = temp_bias_z = 0;
+             last_offset_x = last_offset_y = last_offset_z = 0;
+             temp_model_dirty = true; });
+}
 
-    // g_ratio = g_ratio_table[sensor->accel_cfg.range];
-    // dps_ratio = dps_ratio_table[sensor->gyro_cfg.range];
+void IMU::startCalibration()
+{
+    post([this]()
+         {
+             filter->ResetContinuousCalibration();
+             filter->StartContinuousCalibration();
+             manual_calibration = true; });
+}
 
-    // std::cout << "g ratio: " << g_ratio
-    //           << " dps ratio: " << dps_ratio << std::endl;
+void IMU::stopCalibration()
+{
+    post([this]()
+         {
+             filter->PauseContinuousCalibration();
+             manual_calibration = false; });
+}
 
-    // set device
-    // /* Select the Output data rate, range of accelerometer sensor */
-    // sensor->accel_cfg.odr = BMI160_ACCEL_ODR_1600HZ;
-    // sensor->accel_cfg.range = BMI160_ACCEL_RANGE_16G;
-    // sensor->accel_cfg.bw = BMI160_ACCEL_BW_NORMAL_AVG4;
+void IMU::calibrateNow()
+{
+    {
+        std::lock_guard<std::mutex> lock(command_lock);
+        calibration_result = CalibrationResult();
+        calibration_result.state = CALIBRATION_RUNNING;
+    }
+    post([this]()
+         {
+             burst_calibration.reset();
+             burst_calibrating = true;
+             burst_pending = true; });
+}
 
-    // /* Select the power mode of accelerometer sensor */
-    // sensor->accel_cfg.power = BMI160_ACCEL_NORMAL_MODE;
+CalibrationResult IMU::getCalibrationResult()
+{
+    std::lock_guard<std::mutex> lock(command_lock);
+    return calibration_result;
+}
 
-    // /* Select the Output data rate, range of Gyroscope sensor */
-    // sensor->gyro_cfg.odr = BMI160_GYRO_ODR_3200HZ;
-    // sensor->gyro_cfg.range = BMI160_GYRO_RANGE_2000_DPS;
-    // sensor->gyro_cfg.bw = BMI160_GYRO_BW_NORMAL_MODE;
+/*
+collect raw readings until the burst is complete, then hand the bias to
+the filter as if its own calibration had found it. The filter only sees
+what the temperature model leaves, so that part is taken off.
+*/
+void IMU::calibrateBurst(const ImuReading &reading)
+{
+    burst_calibration.push(reading);
+    if (burst_calibration.getCount() < burst_target)
+        return;
+    burst_calibrating = false;
+    auto result = burst_calibration.finish();
+    if (result.state == CALIBRATION_DONE)
+        filter->SetCalibrationOffset(result.x - temp_bias_x,
+                                     result.y - temp_bias_y,
+                                     result.z - temp_bias_z,
+                                     result.samples);
+    else
+        std::cout << "imu calibration err! device moved" << std::endl;
+    std::lock_guard<std::mutex> lock(command_lock);
+    calibration_result = result;
+}
 
-    // /* Select the power mode of Gyroscope sensor */
-    // sensor->gyro_cfg.power = BMI160_GYRO_NORMAL_MODE;
-    // /* Set the sensor configuration */
-    // auto rslt = bmi160_set_sens_conf(sensor);
-    // std::cout << "set conf ret: " << +rslt << std::endl;
-    g_ratio = g_ratio_table[sensor->accel_cfg.range];
-    dps_ratio = dps_ratio_table[sensor->gyro_cfg.range];
+void IMU::setTemperature(float celsius)
+{
+    temperature = celsius;
+    temp_model.bias(temperature, temp_bias_x, temp_bias_y, temp_bias_z);
+}
 
-    std::cout << "g ratio: " << g_ratio
-              << " dps ratio: " << dps_ratio << std::endl;
-};
+/*
+when the filter's calibration moves, the bias at this temperature is the
+model's prediction plus the filter's residual. Feed it to the model and
+take back from the filter what the model now predicts.
+*/
+void IMU::learnTemperatureBias()
+{
+    float x, y, z;
+    filter->GetCalibrationOffset(x, y, z);
+    if (std::isnan(temperature) || manual_calibration ||
+        (x == last_offset_x && y == last_offset_y && z == last_offset_z))
+        return;
+    temp_model.learn(temperature, temp_bias_x + x, temp_bias_y + y, temp_bias_z + z);
+    float bias_x, bias_y, bias_z;
+    temp_model.bias(temperature, bias_x, bias_y, bias_z);
+    x -= bias_x - temp_bias_x;
+    y -= bias_y - temp_bias_y;
+    z -= bias_z - temp_bias_z;
+    filter->SetCalibrationOffset(x, y, z, 1);
+    temp_bias_x = bias_x;
+    temp_bias_y = bias_y;
+    temp_bias_z = bias_z;
+    last_offset_x = x;
+    last_offset_y = y;
+    last_offset_z = z;
+    temp_model_dirty = true;
+}
 
-IMU::~IMU(){};
+void IMU::saveTempModel()
+{
+    if (temp_model_dirty && std::chrono::steady_clock::now() - temp_model_saved > TEMP_MODEL_SAVE_INTERVAL)
+    {
+        temp_model.save(TEMP_MODEL_PATH);
+        temp_model_dirty = false;
+        temp_model_saved = std::chrono::steady_clock::now();
+    }
+}
 
-Velocity IMU::getMotion()
+/*
+turn a backend reading into a sample, false for the first reading and
+the first one after a pause, which only set the clock
+*/
+bool IMU::ingest(const ImuReading &reading, MotionSample &sample)
 {
-    bmi160_sensor_data *tmp_acc = new bmi160_sensor_data();
-    bmi160_sensor_data *tmp_gyro = new bmi160_sensor_data();
-    auto ret = bmi160_get_sensor_data(BMI160_BOTH_ACCEL_AND_GYRO_WITH_TIME, tmp_acc, tmp_gyro, sensor);
-    if (timestamp == 0)
+    if (!synced)
     {
-        timestamp = tmp_gyro->sensortime * 39 / 1e6;
+        synced = true;
+        resync = false;
+        last_reading = reading.timestamp;
         filter->Reset();
-        filter->SetCalibrationMode(
-            GamepadMotionHelpers::CalibrationMode::Stillness |
-            GamepadMotionHelpers::CalibrationMode::SensorFusion);
+#ifdef IMU_RUNTIME_MOTION_SETTINGS
+        filter->SetCalibrationMode(IMU_CALIBRATION_MODE);
+#endif
+        return false;
     }
-    else
+    if (resync)
     {
-        auto new_timestamp = tmp_gyro->sensortime * 39 / 1e6;
-        delta = new_timestamp - timestamp;
-        filter->ProcessMotion(tmp_gyro->x / dps_ratio,
-                              tmp_gyro->y / dps_ratio,
-                              tmp_gyro->z / dps_ratio,
-                              tmp_acc->x / g_ratio,
-                              tmp_acc->y / g_ratio,
-                              tmp_acc->z / g_ratio,
-                              delta);
-        
-        filter->GetCalibratedGyro(gyro_x, gyro_y, gyro_z);
-        timestamp = new_timestamp;
-
+        // back from a pause, the backend's clock may have wrapped meanwhile
+        resync = false;
+        last_reading = reading.timestamp;
+        timestamp += std::chrono::duration<double>(std::chrono::steady_clock::now() - paused_at).count();
+        return false;
     }
+    if (reading.timestamp <= last_reading)
+        return false;
+    delta = (reading.timestamp - last_reading) / 1e9;
+    last_reading = reading.timestamp;
+    timestamp += delta;
+
+    sample.accel_x = reading.accel_x;
+    sample.accel_y = reading.accel_y;
+    sample.accel_z = reading.accel_z;
+    process(sample, reading.gyro_x, reading.gyro_y, reading.gyro_z);
+    return true;
+}
+
+/*
+filter a sample with timestamp, delta and accel (g) already set, gyro in dps
+*/
+void IMU::process(MotionSample &sample, float dps_x, float dps_y, float dps_z)
+{
+    sample_count.fetch_add(1, std::memory_order_relaxed);
+    sample.timestamp = timestamp;
+    sample.delta = delta;
+    sample.temperature = temperature;
+    filter->ProcessMotion(dps_x - temp_bias_x,
+                          dps_y - temp_bias_y,
+                          dps_z - temp_bias_z,
+                          sample.accel_x,
+                          sample.accel_y,
+                          sample.accel_z,
+                          delta);
+    learnTemperatureBias();
+
+    filter->GetCalibratedGyro(gyro_x, gyro_y, gyro_z);
+    sample.gyro_x = gyro_x;
+    sample.gyro_y = gyro_y;
+    sample.gyro_z = gyro_z;
+    filter->GetGravity(sample.grav_x, sample.grav_y, sample.grav_z);
+    filter->GetOrientation(sample.quat_w, sample.quat_x, sample.quat_y, sample.quat_z);
+    // done once per sample here, consumers only read yaw/pitch
+    to_gyro_space(getGyroSpace(),
+                  gyro_x, gyro_y, gyro_z,
+                  sample.grav_x, sample.grav_y, sample.grav_z,
+                  yaw, pitch);
+    sample.yaw = yaw;
+    sample.pitch = pitch;
+
     auto sensitivity = getSensitivity();
-    auto x = delta * sensitivity * gyro_x;
-    auto y = delta * sensitivity * gyro_y;
-    auto z = delta * sensitivity * gyro_z;
+    {
+        std::lock_guard<std::mutex> lock(motion_lock);
+        acc_x += delta * sensitivity * yaw;
+        acc_y += delta * sensitivity * pitch;
+    }
+}
+
+/*
+yaw/pitch motion since last call in the selected gyro space, scaled by
+sensitivity
+*/
+Velocity IMU::getMotion()
+{
+    std::lock_guard<std::mutex> lock(motion_lock);
+    auto x = acc_x;
+    auto y = acc_y;
+    acc_x = 0;
+    acc_y = 0;
+
+    // printf("gyro: %7.2f %7.2f\n", x, y);
 
-    // printf("delta: %7.2f gyro: %7.2f %7.2f %7.2f\n", delta, x, y, z);
-    
     return Velocity{x,y};
 };
 
 float IMU::getSensitivity()
 {
-    auto speed = sqrt(gyro_x * gyro_x + gyro_y * gyro_y);
-    auto slow_fast_factor = (speed - speed_min_thres) /
-      (speed_max_thres - speed_min_thres);
-    slow_fast_factor = std::clamp(slow_fast_factor, 0.0f, 1.0f);
-    auto sensitivity = slow_factor * (1.0 - slow_fast_factor) + fast_factor * slow_fast_factor;
-    return sensitivity;
-}
\ No newline at end of file
+    auto speed = sqrt(yaw * yaw + pitch * pitch);
+    return (*sensitivity_curve.read())(speed);
+}
+
+/*
+slow factor below speed_min, fast factor above speed_max (dps)
+*/
+CurveSpec IMU::defaultSensitivitySpec()
+{
+    float slow_factor = 1;
+    float fast_factor = 2;
+    float speed_min_thres = 0;
+    float speed_max_thres = 75;
+    return CurveSpec{
+        .type = CURVE_LINEAR,
+        .in_min = speed_min_thres,
+        .in_max = speed_max_thres,
+        .out_min = slow_factor,
+        .out_max = fast_factor};
+}
+
+void IMU::setSensitivityCurve(const CurveSpec &spec)
+{
+    sensitivity_curve.update(new ResponseCurve(spec));
+}
@@ -1,11 +1,21 @@
 #ifndef IMU_HEADER
 #define IMU_HEADER
 #include "GamepadMotion.hpp"
-#include "bmi160/bmi160.h"
-extern "C" {
-    #include <linux/i2c-dev.h>
-    #include <i2c/smbus.h>
-}
+#include "response_curve.h"
+#include "gyro_space.h"
+#include "temp_model.h"
+#include "rcu.h"
+#include "imu_backend.h"
+#include "axis_remap.h"
+#include "health_monitor.h"
+#include "burst_calibration.h"
+#include "bmi160_backend.h"
+#include "bmi26x_backend.h"
+#include "bmi26x_sim.h"
+#include "i2c_discovery.h"
+#include "iio_backend.h"
+#include "sim_backend.h"
+#include "replay_backend.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -16,43 +26,238 @@ extern "C" {
 #include <iostream>
 #include <math.h>
 #include <algorithm>
-#define GRAVITY_EARTH (9.80665f)
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#define TEMP_READ_INTERVAL_S (1.0)
+// learned gyro bias over temperature, saved at most this often
+#define TEMP_MODEL_PATH "/var/lib/oxp_gyro_key_mapper/gyro_temp_model"
+#define TEMP_MODEL_SAVE_INTERVAL (std::chrono::minutes(5))
+// any-motion wakes from idle within this, no-motion is checked this often
+#define IMU_IDLE_POLL_MS (50)
+#define IMU_NO_MOTION_CHECK_MS (500)
+// readings handled per backend read
+#define IMU_READ_MAX (32)
+
+// who needs samples, the sensors are suspended when nobody does
+enum ImuDemand
+{
+    IMU_DEMAND_AIM = 1,    // gyro aiming enabled
+    IMU_DEMAND_DSU = 2,    // subscribed DSU clients
+    IMU_DEMAND_ALWAYS = 4, // power saving disabled in the config
+    IMU_DEMAND_GESTURES = 8, // gestures are bound, idle is enough for them
+};
+
 struct Velocity
 {
     double yaw;
     double pitch;
 };
 
+// one fused IMU sample, gyro in dps (calibrated), accel & gravity in g
+struct MotionSample
+{
+    double timestamp; // seconds since the first sample, from the sensor's clock
+    double delta;     // seconds since previous sample
+    float gyro_x, gyro_y, gyro_z;
+    float accel_x, accel_y, accel_z;
+    float grav_x, grav_y, grav_z;
+    float quat_w, quat_x, quat_y, quat_z;
+    float yaw, pitch; // dps, gyro in the selected GyroSpace
+    float temperature; // degC, NAN until the first reading
+};
 
-class IMU
+typedef std::function<void(const MotionSample &)> MotionListener;
+// IMU_GESTURE_* bits detected by the sensor
+typedef std::function<void(uint32_t)> GestureListener;
+// called after the samples of one backend read were delivered
+typedef std::function<void()> TickListener;
+
+// where the IMU sits in a device, from the device profile, an empty bus
+// if it has to be discovered
+struct ImuPlacement
 {
-private:
+    std::string bus = I2C_BUS_PATH;
+    uint8_t addr = BMI160_I2C_ADDR;
+    AxisRemapId axes = AXIS_REMAP_IDENTITY;
+};
+
+// settings and calibration mode are compile time constants unless built
+// with IMU_RUNTIME_MOTION_SETTINGS, which allows tuning filter->Settings
+#define IMU_CALIBRATION_MODE (GamepadMotionHelpers::CalibrationMode::Stillness | \
+                              GamepadMotionHelpers::CalibrationMode::SensorFusion)
+#ifdef IMU_RUNTIME_MOTION_SETTINGS
+typedef GamepadMotion MotionFilter;
+#else
+typedef BasicGamepadMotion<ConstGamepadMotionSettings,
+                           GamepadMotionHelpers::FixedCalibrationMode<IMU_CALIBRATION_MODE>>
+    MotionFilter;
+#endif
 
-    float g_ratio_table[13] = {0, 0, 0, 16384, 0, 8192, 0, 0, 2096, 0, 0, 0, 2048};
-    float dps_ratio_table[5] = {16.4, 32.8, 65.6, 131.2, 262.4};
+
+/*
+Sampling, filtering and power management shared by all backends. The
+sampling loop lives in BasicIMU, compiled once per backend so the
+backend's read path is inlined into it.
+*/
+class IMU
+{
+protected:
     double timestamp = 0;
     float gyro_x = 0;
     float gyro_y = 0;
     float gyro_z = 0;
     double delta = 0;
+    // backend timestamp (ns) of the last reading
+    int64_t last_reading = 0;
+    bool synced = false;
+    // chip to device axes, fixed before start()
+    AxisRemapId axis_remap = AXIS_REMAP_IDENTITY;
 
-    // sensitivity
-    float slow_factor = 1;
-    float fast_factor = 2;
-    float speed_min_thres = 0;
-    float speed_max_thres = 75;
-    bmi160_dev* sensor;
-    GamepadMotion* filter;
+    // yaw/pitch in gyro_space, as accumulated by getMotion
+    float yaw = 0;
+    float pitch = 0;
+    std::atomic<int> gyro_space = GYRO_LOCAL;
 
-    bmi160_offsets offsets;
+    // gyro speed (dps) -> sensitivity, read by the sampling thread
+    Rcu<ResponseCurve> sensitivity_curve;
+    MotionFilter* filter;
 
-    float g_ratio, dps_ratio;
+    // sampling thread, the only user of the backend & filter once started
+    std::thread sampler;
+    std::atomic<bool> running = false;
+    std::vector<MotionListener> listeners;
+    std::vector<GestureListener> gesture_listeners;
+    std::vector<TickListener> tick_listeners;
+
+    // motion accumulated since last getMotion(), guarded by motion_lock
+    std::mutex motion_lock;
+    double acc_x = 0;
+    double acc_y = 0;
+
+    // run by the sampling thread, which owns the filter
+    std::mutex command_lock;
+    std::vector<std::function<void()>> commands;
+    std::atomic<bool> has_commands = false;
+    // wakes the sampling thread while it is off, guarded by command_lock
+    std::condition_variable wakeup;
+    std::atomic<uint64_t> sample_count = 0;
+
+    // temperature compensation, sampling thread only. The model predicts
+    // the bias, which is removed before the filter, the filter's own
+    // calibration only tracks the residual and feeds the model
+    TempModel temp_model;
+    float temperature = NAN;
+    double temp_timestamp = -TEMP_READ_INTERVAL_S;
+    float temp_bias_x = 0, temp_bias_y = 0, temp_bias_z = 0;
+    float last_offset_x = 0, last_offset_y = 0, last_offset_z = 0;
+    bool manual_calibration = false;
+    bool temp_model_dirty = false;
+
+    // calibrate now: a burst of readings, at a raised rate where the
+    // backend can. The result is guarded by command_lock
+    BurstCalibration burst_calibration;
+    bool burst_calibrating = false;
+    bool burst_pending = false;
+    int burst_target = BURST_CALIBRATION_SAMPLES;
+    // where the sensors were before a burst woke them
+    PowerState burst_return = POWER_ACTIVE;
+    CalibrationResult calibration_result;
+
+    // power management, state is only changed by the sampling thread
+    std::atomic<uint32_t> demand = 0;
+    std::atomic<int> power_state = POWER_ACTIVE;
+    // the next reading only resyncs the clock after a pause
+    bool resync = false;
+    std::chrono::steady_clock::time_point paused_at;
+    std::chrono::steady_clock::time_point temp_model_saved;
+    // sensor health, checked by the sampling thread after every read
+    HealthMonitor health;
+
+    void post(std::function<void()> command);
+    void runCommands();
+    void setTemperature(float celsius);
+    void learnTemperatureBias();
+    void saveTempModel();
+    void calibrateBurst(const ImuReading &reading);
+    bool ingest(const ImuReading &reading, MotionSample &sample);
+    void process(MotionSample &sample, float dps_x, float dps_y, float dps_z);
+    virtual void sampleLoop() = 0;
 public:
     IMU();
+    virtual ~IMU();
+    // backend names for create(), device is the iio sysfs dir, the replay
+    // file or the BMI26x config file
+    static bool isBackend(const std::string &name);
+    static IMU *create(const std::string &backend, const std::string &device, const ImuPlacement &placement = {});
+    virtual bool isOpen() = 0;
+    // chip to device axes, call before start()
+    void setAxisRemap(AxisRemapId axes) { axis_remap = axes; };
+    void addListener(MotionListener listener);
+    void addGestureListener(GestureListener listener);
+    void addTickListener(TickListener listener);
+    void start();
+    void stop();
     Velocity getMotion();
     float getSensitivity();
+    static CurveSpec defaultSensitivitySpec();
+    // single writer, call from the main loop only
+    void setSensitivityCurve(const CurveSpec &spec);
+    // conversion of the gyro used by getMotion, applies from the next sample
+    void setGyroSpace(GyroSpace space) { gyro_space = space; };
+    GyroSpace getGyroSpace() { return static_cast<GyroSpace>(gyro_space.load()); };
+    // forget the learned gyro bias, including the temperature model
+    void resetCalibration();
+    // manual calibration, average all samples until stopCalibration, keep still
+    void startCalibration();
+    void stopCalibration();
+    // bias from a short burst while the device lies still, rejected if it
+    // moved, the outcome is in getCalibrationResult. Wakes idle or
+    // suspended sensors for the burst
+    void calibrateNow();
+    CalibrationResult getCalibrationResult();
+    uint64_t getSampleCount() { return sample_count; };
+    // the sensors run while any demand is set, thread safe
+    void setDemand(ImuDemand source, bool on);
+    PowerState getPowerState() { return static_cast<PowerState>(power_state.load()); };
+    // incidents and recoveries of the sensor, thread safe
+    ImuHealth getHealth() { return health.getStats(); };
     // std::vector<float> getOrient();
-    ~IMU();
 };
 
+template <ImuBackend Backend>
+class BasicIMU : public IMU
+{
+private:
+    Backend backend;
+
+    void setPowerState(PowerState state);
+    void recover(HealthIssue issue);
+    void notifyGestures();
+    // gestures need no samples where the backend has none
+    uint32_t servedDemand() const { return Backend::has_gestures ? demand.load() : demand & ~IMU_DEMAND_GESTURES; };
+    void sampleLoop() override;
+    template <AxisRemapId Axes>
+    void runSampler();
+
+public:
+    template <typename... Args>
+    BasicIMU(Args &&...args) : backend(std::forward<Args>(args)...){};
+    // stop the sampler before the backend goes away
+    ~BasicIMU() { stop(); };
+    bool isOpen() override { return backend.isOpen(); };
+};
+
+extern template class BasicIMU<Bmi160Backend>;
+extern template class BasicIMU<Bmi26xBackend<I2cBus>>;
+extern template class BasicIMU<Bmi26xBackend<Bmi26xSimBus>>;
+extern template class BasicIMU<IioBackend>;
+extern template class BasicIMU<SimBackend>;
+extern template class BasicIMU<ReplayBackend>;
+
 #endif
@@ -0,0 +1,74 @@
+#ifndef IMU_BACKEND_HEADER
+#define IMU_BACKEND_HEADER
+#include <stddef.h>
+#include <stdint.h>
+#include <concepts>
+
+#define GRAVITY_EARTH (9.80665f)
+
+enum PowerState
+{
+    POWER_OFF,    // gyro & accel suspended, nothing polled
+    POWER_IDLE,   // no-motion, gyro in fast start-up, polling for any-motion
+    POWER_ACTIVE, // sampling at the output data rate
+};
+
+// one raw sample of a backend, before calibration and filtering
+struct ImuReading
+{
+    int64_t timestamp; // ns, monotonic for the life of the backend
+    float gyro_x, gyro_y, gyro_z;    // dps
+    float accel_x, accel_y, accel_z; // g
+};
+
+// incidents a backend counts itself, watched by the health monitor
+struct BackendHealth
+{
+    uint64_t bus_errors = 0; // failed transfers
+    uint64_t stalls = 0;     // reads where the sensor's clock did not move
+    uint64_t overflows = 0;  // FIFO overflows, samples were lost
+    uint64_t resets = 0;     // the sensor's clock started over, config may be lost
+};
+
+// gestures detected by the sensor itself, bit i is gesture i
+enum ImuGesture
+{
+    IMU_GESTURE_TAP = 1,         // a double tap sends its taps as well
+    IMU_GESTURE_DOUBLE_TAP = 2,
+    IMU_GESTURE_HIGH_G = 4,      // a hard knock or jerk
+    IMU_GESTURE_ORIENTATION = 8, // portrait/landscape or face up/down changed
+    IMU_GESTURE_FLAT = 16,       // laid down flat
+};
+#define IMU_GESTURE_COUNT (5)
+
+/*
+Where IMU samples come from. read() paces the sampler: it waits up to
+about one sample period and returns the readings available by then, 0
+if there are none. Backends without motion interrupts or a temperature
+sensor return false from those calls and are never put into idle.
+recover() brings a misbehaving sensor back to the configured state
+without losing its calibration, false if it did not answer. Backends with
+burst capture sample up to max readings at a raised rate for calibration,
+continuing read()'s clock, the others return 0. Backends with gestures
+return the IMU_GESTURE_* bits the chip detected since the last call, as
+seen by read() and the motion polls, the others return 0.
+*/
+template <typename T>
+concept ImuBackend = requires(T backend, ImuReading *readings, size_t max, PowerState state, float &celsius) {
+    { backend.isOpen() } -> std::same_as<bool>;
+    { backend.getSamplePeriodUs() } -> std::convertible_to<int>;
+    { backend.read(readings, max) } -> std::same_as<size_t>;
+    { backend.setPowerState(state) } -> std::same_as<void>;
+    { backend.readTemperature(celsius) } -> std::same_as<bool>;
+    { backend.anyMotion() } -> std::same_as<bool>;
+    { backend.noMotion() } -> std::same_as<bool>;
+    { backend.getHealth() } -> std::convertible_to<BackendHealth>;
+    { backend.recover() } -> std::same_as<bool>;
+    { backend.captureBurst(readings, max) } -> std::same_as<size_t>;
+    { backend.gestures() } -> std::same_as<uint32_t>;
+    { T::has_motion_interrupts } -> std::convertible_to<bool>;
+    { T::has_burst_capture } -> std::convertible_to<bool>;
+    { T::has_gestures } -> std::convertible_to<bool>;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef RCU_HEADER
+#define RCU_HEADER
+#include <atomic>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/*
+RCU style pointer for data read on a hot path. Readers do a single atomic
+load and never lock, the writer swaps in a new version and frees old ones
+once the reader thread has passed quiesce() after the swap. Single writer,
+single reader thread; a reader on the writer's own thread can call
+quiesce() right after update().
+*/
+template <typename T>
+class Rcu
+{
+private:
+    std::atomic<T *> current;
+    std::atomic<uint64_t> epoch = 0;
+    // writer only, versions waiting for the reader to move on
+    std::vector<std::pair<uint64_t, T *>> retired;
+
+public:
+    Rcu(T *initial) : current(initial){};
+    ~Rcu()
+    {
+        for (auto &old : retired)
+            delete old.second;
+        delete current.load();
+    };
+    Rcu(const Rcu &) = delete;
+    Rcu &operator=(const Rcu &) = delete;
+
+    const T *read() const { return current.load(std::memory_order_acquire); };
+    // reader holds no pointer obtained from read() anymore
+    void quiesce() { epoch.fetch_add(1, std::memory_order_release); };
+
+    void update(T *next)
+    {
+        auto old = current.exchange(next, std::memory_order_acq_rel);
+        retired.emplace_back(epoch.load(std::memory_order_acquire), old);
+        reclaim();
+    };
+    void reclaim()
+    {
+        auto now = epoch.load(std::memory_order_acquire);
+        std::erase_if(retired, [now](const std::pair<uint64_t, T *> &old)
+                      {
+                          if (old.first >= now)
+                              return false;
+                          delete old.second;
+                          return true; });
+    };
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "replay_backend.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/*
+timestamps are made relative to the first sample, the period is the mean
+spacing of the recording
+*/
+ReplayBackend::ReplayBackend(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        double seconds;
+        ImuReading reading;
+        if (!(fields >> seconds >> reading.gyro_x >> reading.gyro_y >> reading.gyro_z >>
+              reading.accel_x >> reading.accel_y >> reading.accel_z))
+        {
+            std::cout << "replay line err! " << line << std::endl;
+            continue;
+        }
+        reading.timestamp = seconds * 1e9;
+        recording.push_back(reading);
+    }
+    if (recording.empty())
+    {
+        std::cout << "replay file err! " << path << std::endl;
+        return;
+    }
+    auto first = recording.front().timestamp;
+    for (auto &reading : recording)
+        reading.timestamp -= first;
+    if (recording.size() > 1 && recording.back().timestamp > 0)
+        period = recording.back().timestamp / (recording.size() - 1);
+    start = std::chrono::steady_clock::now();
+}
+
+/*
+the recording keeps its own clock, after a pause it continues where it
+stopped
+*/
+void ReplayBackend::setPowerState(PowerState state)
+{
+    if (state != POWER_ACTIVE)
+        return;
+    auto reading = recording[index];
+    start = std::chrono::steady_clock::now() - std::chrono::nanoseconds(reading.timestamp + offset);
+}
@@ -0,0 +1,58 @@
+#ifndef REPLAY_BACKEND_HEADER
+#define REPLAY_BACKEND_HEADER
+#include "imu_backend.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Plays back a recorded text file, one "seconds gyro_x gyro_y gyro_z
+accel_x accel_y accel_z" line per sample (dps, g), at the recorded pace.
+Starts over at the end.
+*/
+class ReplayBackend
+{
+private:
+    std::vector<ImuReading> recording;
+    size_t index = 0;
+    // added to the recorded timestamps, grows by the length on every loop
+    int64_t offset = 0;
+    int64_t period = 10000000;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    static constexpr bool has_motion_interrupts = false;
+    static constexpr bool has_burst_capture = false;
+    static constexpr bool has_gestures = false;
+
+    ReplayBackend(const std::string &path);
+    bool isOpen() const { return !recording.empty(); };
+    int getSamplePeriodUs() const { return period / 1000; };
+    void setPowerState(PowerState state);
+    bool readTemperature(float &celsius) { return false; };
+    bool anyMotion() { return false; };
+    bool noMotion() { return false; };
+    BackendHealth getHealth() const { return {}; };
+    bool recover() { return true; };
+    size_t captureBurst(ImuReading *readings, size_t max) { return 0; };
+    uint32_t gestures() { return 0; };
+
+    inline size_t read(ImuReading *readings, size_t max)
+    {
+        if (max == 0)
+            return 0;
+        auto reading = recording[index];
+        reading.timestamp += offset;
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(reading.timestamp));
+        readings[0] = reading;
+        if (++index == recording.size())
+        {
+            index = 0;
+            offset += recording.back().timestamp + period;
+        }
+        return 1;
+    }
+};
+
+#endif
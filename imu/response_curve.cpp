@@ -0,0 +1,112 @@
+#include "response_curve.h"
+#include <sstream>
+#include <vector>
+
+bool parse_curve_spec(const std::string &text, CurveSpec &spec)
+{
+    std::vector<std::string> args;
+    std::stringstream ss(text);
+    std::string arg;
+    while (std::getline(ss, arg, ':'))
+        args.push_back(arg);
+    if (args.size() < 5)
+        return false;
+
+    CurveSpec parsed;
+    size_t params = 0;
+    if (args[0] == "linear")
+        parsed.type = CURVE_LINEAR;
+    else if (args[0] == "power")
+        parsed.type = CURVE_POWER, params = 1;
+    else if (args[0] == "s-curve")
+        parsed.type = CURVE_S_CURVE, params = 1;
+    else if (args[0] == "anti-deadzone")
+        parsed.type = CURVE_ANTI_DEADZONE;
+    else if (args[0] == "acceleration")
+        parsed.type = CURVE_ACCELERATION, params = 2;
+    else
+        return false;
+    if (args.size() != 5 + params)
+        return false;
+
+    std::vector<float> values;
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        char *end;
+        values.push_back(strtof(args[i].c_str(), &end));
+        if (end == args[i].c_str() || *end != 0)
+            return false;
+    }
+    parsed.in_min = values[0];
+    parsed.in_max = values[1];
+    parsed.out_min = values[2];
+    parsed.out_max = values[3];
+    if (parsed.type == CURVE_ACCELERATION)
+    {
+        parsed.gain_min = values[4];
+        parsed.gain_max = values[5];
+        if (parsed.gain_max <= 0)
+            return false;
+    }
+    else if (params == 1)
+        parsed.exponent = values[4];
+    if (parsed.in_min < 0 || parsed.in_max <= parsed.in_min)
+        return false;
+    spec = parsed;
+    return true;
+}
+
+std::string format_curve_spec(const CurveSpec &spec)
+{
+    const char *names[] = {"linear", "power", "s-curve", "anti-deadzone", "acceleration"};
+    std::stringstream ss;
+    ss << names[spec.type] << ":" << spec.in_min << ":" << spec.in_max
+       << ":" << spec.out_min << ":" << spec.out_max;
+    if (spec.type == CURVE_POWER || spec.type == CURVE_S_CURVE)
+        ss << ":" << spec.exponent;
+    else if (spec.type == CURVE_ACCELERATION)
+        ss << ":" << spec.gain_min << ":" << spec.gain_max;
+    return ss.str();
+}
+
+ResponseCurve::ResponseCurve(const CurveSpec &spec, int size) : spec(spec)
+{
+    size = std::max(size, 2);
+    scale = spec.in_max > 0 ? (size - 1) / spec.in_max : 0;
+    max_pos = size - 1;
+    lut.resize(size + 1);
+    for (int i = 0; i < size; i++)
+        lut[i] = evaluate(spec, spec.in_max * i / (size - 1));
+    lut[size] = lut[size - 1];
+}
+
+float ResponseCurve::evaluate(const CurveSpec &spec, float x)
+{
+    auto range = spec.in_max - spec.in_min;
+    auto t = range > 0 ? std::clamp((x - spec.in_min) / range, 0.0f, 1.0f) : 1.0f;
+    float shaped = t;
+    switch (spec.type)
+    {
+    case CURVE_LINEAR:
+        break;
+    case CURVE_POWER:
+        shaped = pow(t, spec.exponent);
+        break;
+    case CURVE_S_CURVE:
+    {
+        auto a = pow(t, spec.exponent);
+        auto b = pow(1 - t, spec.exponent);
+        shaped = a + b > 0 ? a / (a + b) : t;
+    }
+    break;
+    case CURVE_ANTI_DEADZONE:
+        if (x < spec.in_min)
+            return spec.out_min * x / spec.in_min;
+        break;
+    case CURVE_ACCELERATION:
+        // integral style gain, normalized so that t = 1 maps to 1
+        shaped = t * (spec.gain_min + (spec.gain_max - spec.gain_min) * t) / spec.gain_max;
+        break;
+    }
+    return spec.out_min + shaped * (spec.out_max - spec.out_min);
+}
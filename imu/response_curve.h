@@ -0,0 +1,71 @@
+#ifndef RESPONSE_CURVE_HEADER
+#define RESPONSE_CURVE_HEADER
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <string>
+
+#define RESPONSE_CURVE_LUT_SIZE (256)
+
+enum CurveType
+{
+    CURVE_LINEAR = 0,        // clamped linear, in_min acts as dead zone
+    CURVE_POWER = 1,         // t^exponent
+    CURVE_S_CURVE = 2,       // t^e / (t^e + (1-t)^e)
+    CURVE_ANTI_DEADZONE = 3, // ramp 0..out_min below in_min, linear above
+    CURVE_ACCELERATION = 4,  // gain rises from gain_min to gain_max with input
+};
+
+/*
+Input is a magnitude, clamped to [0, in_max]. Inside [in_min, in_max] the
+shaped value t in [0, 1] is mapped onto [out_min, out_max].
+*/
+struct CurveSpec
+{
+    CurveType type = CURVE_LINEAR;
+    float in_min = 0;
+    float in_max = 1;
+    float out_min = 0;
+    float out_max = 1;
+    float exponent = 2;
+    float gain_min = 1;
+    float gain_max = 2;
+};
+
+/*
+parse "type:in_min:in_max:out_min:out_max[:exponent]" or
+"acceleration:in_min:in_max:out_min:out_max:gain_min:gain_max",
+type is one of linear, power, s-curve, anti-deadzone, acceleration
+*/
+bool parse_curve_spec(const std::string &text, CurveSpec &spec);
+std::string format_curve_spec(const CurveSpec &spec);
+
+/*
+Curve compiled into a dense lookup table over [0, in_max], evaluated with
+linear interpolation and without branches.
+*/
+class ResponseCurve
+{
+private:
+    CurveSpec spec;
+    float scale;
+    float max_pos;
+    // one extra entry so that the last interval never reads past the end
+    std::vector<float> lut;
+
+    static float evaluate(const CurveSpec &spec, float x);
+
+public:
+    ResponseCurve(const CurveSpec &spec, int size = RESPONSE_CURVE_LUT_SIZE);
+    const CurveSpec &getSpec() const { return spec; };
+
+    float operator()(float x) const
+    {
+        auto pos = std::clamp(x * scale, 0.0f, max_pos);
+        auto i = static_cast<int>(pos);
+        auto frac = pos - i;
+        return lut[i] + frac * (lut[i + 1] - lut[i]);
+    };
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef SIM_BACKEND_HEADER
+#define SIM_BACKEND_HEADER
+#include "imu_backend.h"
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#define SIM_SAMPLE_RATE (100)
+// constant gyro bias and noise (dps), accel noise (g)
+#define SIM_GYRO_BIAS (0.3f)
+#define SIM_GYRO_NOISE (0.05f)
+#define SIM_ACCEL_NOISE (0.002f)
+// slow yaw sweep, peak dps and period
+#define SIM_YAW_DPS (30.0f)
+#define SIM_YAW_PERIOD_S (4.0f)
+
+/*
+Synthetic samples for running without hardware: the handheld held
+upright (x up), sweeping left and right, with gyro bias and noise.
+*/
+class SimBackend
+{
+private:
+    std::mt19937 rng;
+    std::normal_distribution<float> noise{0, 1};
+    std::chrono::microseconds period{1000000 / SIM_SAMPLE_RATE};
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    int64_t time = 0;
+
+public:
+    static constexpr bool has_motion_interrupts = false;
+    static constexpr bool has_burst_capture = false;
+    static constexpr bool has_gestures = false;
+
+    // the noise free signal at a time, also fed to the BMI26x simulator
+    static void motion(double seconds, ImuReading &reading)
+    {
+        float phase = 2 * M_PI * seconds / SIM_YAW_PERIOD_S;
+        reading.gyro_x = SIM_YAW_DPS * sinf(phase) + SIM_GYRO_BIAS;
+        reading.gyro_y = SIM_GYRO_BIAS;
+        reading.gyro_z = SIM_GYRO_BIAS;
+        reading.accel_x = 1;
+        reading.accel_y = 0;
+        reading.accel_z = 0;
+    }
+
+    bool isOpen() const { return true; };
+    int getSamplePeriodUs() const { return period.count(); };
+    void setPowerState(PowerState state) { next = std::chrono::steady_clock::now(); };
+    bool readTemperature(float &celsius) { return false; };
+    bool anyMotion() { return false; };
+    bool noMotion() { return false; };
+    BackendHealth getHealth() const { return {}; };
+    bool recover() { return true; };
+    size_t captureBurst(ImuReading *readings, size_t max) { return 0; };
+    uint32_t gestures() { return 0; };
+
+    inline size_t read(ImuReading *readings, size_t max)
+    {
+        std::this_thread::sleep_until(next);
+        next += period;
+        if (max == 0)
+            return 0;
+        time += std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+        auto &reading = readings[0];
+        motion(time / 1e9, reading);
+        reading.timestamp = time;
+        reading.gyro_x += SIM_GYRO_NOISE * noise(rng);
+        reading.gyro_y += SIM_GYRO_NOISE * noise(rng);
+        reading.gyro_z += SIM_GYRO_NOISE * noise(rng);
+        reading.accel_x += SIM_ACCEL_NOISE * noise(rng);
+        reading.accel_y += SIM_ACCEL_NOISE * noise(rng);
+        reading.accel_z += SIM_ACCEL_NOISE * noise(rng);
+        return 1;
+    }
+};
+
+#endif
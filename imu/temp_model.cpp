@@ -0,0 +1,132 @@
+#include "temp_model.h"
+#include <math.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+void TempModel::bias(float temp, float &x, float &y, float &z) const
+{
+    if (!fitted)
+    {
+        x = y = z = 0;
+        return;
+    }
+    auto dt = std::clamp(temp, temp_min - TEMP_MODEL_EXTRAPOLATE_C, temp_max + TEMP_MODEL_EXTRAPOLATE_C) - center;
+    x = offset_x + slope_x * dt;
+    y = offset_y + slope_y * dt;
+    z = offset_z + slope_z * dt;
+}
+
+void TempModel::learn(float temp, float x, float y, float z)
+{
+    int i = static_cast<int>((temp - TEMP_MODEL_MIN_C) / TEMP_MODEL_BIN_C);
+    if (i < 0 || i >= TEMP_MODEL_BINS)
+        return;
+    auto &bin = bins[i];
+    bin.weight = std::min(bin.weight + 1, TEMP_MODEL_MAX_WEIGHT);
+    float k = 1.0f / bin.weight;
+    bin.temp += (temp - bin.temp) * k;
+    bin.x += (x - bin.x) * k;
+    bin.y += (y - bin.y) * k;
+    bin.z += (z - bin.z) * k;
+    fit();
+}
+
+void TempModel::clear()
+{
+    bins.fill(TempBin());
+    fitted = false;
+}
+
+/*
+weighted least squares line through the bins, flat if they span only a
+few degrees
+*/
+void TempModel::fit()
+{
+    float w_sum = 0, t_sum = 0, x_sum = 0, y_sum = 0, z_sum = 0;
+    temp_min = INFINITY;
+    temp_max = -INFINITY;
+    for (const auto &bin : bins)
+    {
+        if (bin.weight == 0)
+            continue;
+        w_sum += bin.weight;
+        t_sum += bin.weight * bin.temp;
+        x_sum += bin.weight * bin.x;
+        y_sum += bin.weight * bin.y;
+        z_sum += bin.weight * bin.z;
+        temp_min = std::min(temp_min, bin.temp);
+        temp_max = std::max(temp_max, bin.temp);
+    }
+    fitted = w_sum > 0;
+    if (!fitted)
+        return;
+    center = t_sum / w_sum;
+    offset_x = x_sum / w_sum;
+    offset_y = y_sum / w_sum;
+    offset_z = z_sum / w_sum;
+    slope_x = slope_y = slope_z = 0;
+    if (temp_max - temp_min < TEMP_MODEL_MIN_SPAN_C)
+        return;
+
+    float tt = 0, tx = 0, ty = 0, tz = 0;
+    for (const auto &bin : bins)
+    {
+        if (bin.weight == 0)
+            continue;
+        auto dt = bin.temp - center;
+        tt += bin.weight * dt * dt;
+        tx += bin.weight * dt * (bin.x - offset_x);
+        ty += bin.weight * dt * (bin.y - offset_y);
+        tz += bin.weight * dt * (bin.z - offset_z);
+    }
+    slope_x = tx / tt;
+    slope_y = ty / tt;
+    slope_z = tz / tt;
+}
+
+/*
+one "temp weight x y z" line per learned bin
+*/
+bool TempModel::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+    clear();
+    TempBin bin;
+    while (file >> bin.temp >> bin.weight >> bin.x >> bin.y >> bin.z)
+    {
+        int i = static_cast<int>((bin.temp - TEMP_MODEL_MIN_C) / TEMP_MODEL_BIN_C);
+        if (i >= 0 && i < TEMP_MODEL_BINS && bin.weight > 0)
+        {
+            bin.weight = std::min(bin.weight, TEMP_MODEL_MAX_WEIGHT);
+            bins[i] = bin;
+        }
+    }
+    fit();
+    return true;
+}
+
+bool TempModel::save(const std::string &path) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    // write aside and rename, so a crash never leaves a truncated model
+    auto tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path);
+        if (!file)
+            return false;
+        for (const auto &bin : bins)
+        {
+            if (bin.weight > 0)
+                file << bin.temp << " " << bin.weight << " " << bin.x << " " << bin.y << " " << bin.z << "\n";
+        }
+        if (!file)
+            return false;
+    }
+    std::filesystem::rename(tmp_path, path, error);
+    return !error;
+}
@@ -0,0 +1,51 @@
+#ifndef TEMP_MODEL_HEADER
+#define TEMP_MODEL_HEADER
+#include <array>
+#include <string>
+
+// bins of the learned bias, 2 degC wide from -10 to 86 degC
+#define TEMP_MODEL_MIN_C (-10.0f)
+#define TEMP_MODEL_BIN_C (2.0f)
+#define TEMP_MODEL_BINS (48)
+// a bin follows new observations with at least this weight
+#define TEMP_MODEL_MAX_WEIGHT (20)
+// below this span of learned temperatures the slope is not trusted
+#define TEMP_MODEL_MIN_SPAN_C (4.0f)
+// how far the fitted line is extrapolated past the learned range
+#define TEMP_MODEL_EXTRAPOLATE_C (10.0f)
+
+struct TempBin
+{
+    int weight = 0;
+    float temp = 0; // mean temperature of the observations
+    float x = 0, y = 0, z = 0;
+};
+
+/*
+Gyro bias (dps) as a function of die temperature. Bias observations from
+the calibration are averaged into temperature bins and a weighted line
+is fitted through the bins, so the bias can be predicted for
+temperatures the device has been at before and a bit beyond.
+*/
+class TempModel
+{
+private:
+    std::array<TempBin, TEMP_MODEL_BINS> bins;
+    // fitted bias = offset + slope * (temp - center)
+    float center = 0, temp_min = 0, temp_max = 0;
+    float offset_x = 0, offset_y = 0, offset_z = 0;
+    float slope_x = 0, slope_y = 0, slope_z = 0;
+    bool fitted = false;
+
+    void fit();
+
+public:
+    bool isFitted() const { return fitted; };
+    void bias(float temp, float &x, float &y, float &z) const;
+    void learn(float temp, float x, float y, float z);
+    void clear();
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+};
+
+#endif
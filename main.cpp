@@ -5,14 +5,65 @@
 #include <chrono>
 #include <filesystem>
 #include "uinput.hpp"
+#include "dsu_server.hpp"
+#include "motion_shm.hpp"
+#include "config.hpp"
+#include "control_server.hpp"
+#include "device_profile.hpp"
+#include <fstream>
+#include <sstream>
+#include <set>
 
+#define INPUT_DEVICES_PATH "/proc/bus/input/devices"
+
+// event node of the device from the kernel's list, "" if it is not there
+std::string find_event_node(const std::string &name)
+{
+    std::ifstream devices(INPUT_DEVICES_PATH);
+    std::string line;
+    bool match = false;
+    while (std::getline(devices, line))
+    {
+        if (line.rfind("N: Name=", 0) == 0)
+            match = line == "N: Name=\"" + name + "\"";
+        else if (match && line.rfind("H: Handlers=", 0) == 0)
+        {
+            std::istringstream handlers(line.substr(12));
+            std::string handler;
+            while (handlers >> handler)
+            {
+                if (handler.rfind("event", 0) == 0)
+                    return "/dev/input/" + handler;
+            }
+        }
+    }
+    return "";
+}
+
+/*
+straight to the node listed for the name, opening every node is the
+fallback
+*/
 libevdev *get_dev_by_name(std::string name)
 {
     auto input_root_path = "/dev/input/";
     struct libevdev *dev;
+    auto node = find_event_node(name);
+    if (!node.empty())
+    {
+        int fd = open(node.c_str(), O_RDWR | O_NONBLOCK);
+        if (fd >= 0 && libevdev_new_from_fd(fd, &dev) == 0)
+        {
+            if (libevdev_get_name(dev) == name)
+                return dev;
+            libevdev_free(dev);
+        }
+        if (fd >= 0)
+            close(fd);
+    }
     for (const auto &file : std::filesystem::directory_iterator(input_root_path))
     {
-        int tmp_fd = open(file.path().c_str(), O_RDONLY | O_NONBLOCK);
+        int tmp_fd = open(file.path().c_str(), O_RDWR | O_NONBLOCK);
         auto err = libevdev_new_from_fd(tmp_fd, &dev);
         if (err == 0)
         {
@@ -27,10 +78,18 @@ libevdev *get_dev_by_name(std::string name)
     return nullptr;
 }
 
+std::vector<int> merge_codes(std::vector<int> codes, const std::vector<int> &extra)
+{
+    std::set<int> merged(codes.begin(), codes.end());
+    merged.insert(extra.begin(), extra.end());
+    return std::vector<int>(merged.begin(), merged.end());
+}
+
 libevdev_uinput *create_uinput_dev(std::string name,
                                    libevdev *ref_dev,
                                    std::map<int, std::vector<int>> code_list,
-                                   std::map<int, const input_absinfo *> absinfo_map)
+                                   std::map<int, const input_absinfo *> absinfo_map,
+                                   std::vector<int> prop_list = {})
 {
     struct libevdev *dev;
     struct libevdev_uinput *uidev;
@@ -56,6 +115,8 @@ libevdev_uinput *create_uinput_dev(std::string name,
         for (const auto &abs_pair : absinfo_map)
             libevdev_enable_event_code(dev, EV_ABS, abs_pair.first, abs_pair.second);
     }
+    for (const auto &prop : prop_list)
+        libevdev_enable_property(dev, prop);
     auto ret = libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &uidev);
     return uidev;
 }
@@ -67,9 +128,25 @@ int main(int argc, char const *argv[])
     struct libevdev *src_dev;
     struct libevdev *fn_dev;
 
+    // --profile <name>, detected from the DMI ids otherwise
+    const DeviceProfile *profile = &detect_device_profile();
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) != "--profile")
+            continue;
+        profile = find_device_profile(argv[i + 1]);
+        if (profile == nullptr)
+        {
+            std::cout << "unknown device profile " << argv[i + 1] << std::endl;
+            return 1;
+        }
+    }
+    set_device_profile(*profile);
+    std::cout << "device profile " << profile->name << std::endl;
+
     // grab source gamepad and fn input device
-    src_dev = get_dev_by_name("Microsoft X-Box 360 pad");
-    fn_dev = get_dev_by_name("AT Translated Set 2 keyboard");
+    src_dev = get_dev_by_name(profile->gamepad);
+    fn_dev = get_dev_by_name(profile->fn_keyboard);
     err = libevdev_grab(src_dev, LIBEVDEV_GRAB);
     if (err != 0)
     {
@@ -83,31 +160,108 @@ int main(int argc, char const *argv[])
         return err;
     }
 
+    // --config <file>, defaults if missing or invalid
+    std::string config_path = DEFAULT_CONFIG_PATH;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--config")
+            config_path = argv[i + 1];
+    }
+    Config *config = nullptr;
+    if (std::filesystem::exists(config_path))
+        config = load_config(config_path.c_str(), src_dev, fn_dev);
+    if (config == nullptr)
+        config = new Config();
+    const auto &js_mapping = config->js_mapping;
+    const auto &mouse_mapping = config->mouse_mapping;
+    const auto &fn_mapping = config->fn_mapping;
+    const auto &gesture_mapping = config->gesture_mapping;
+
+    // enable whatever the mappings can emit on top of the plain gamepad/mouse codes
+    std::map<int, const input_absinfo *> gamepad_absinfo;
+    for (auto code : merge_codes({ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ, ABS_HAT0X, ABS_HAT0Y}, js_mapping.targets(EV_ABS)))
+        gamepad_absinfo[code] = libevdev_get_abs_info(src_dev, code);
+    auto gamepad_keys = merge_codes({BTN_NORTH, BTN_SOUTH, BTN_WEST, BTN_EAST, BTN_TL, BTN_TR, BTN_SELECT, BTN_START, BTN_MODE, BTN_THUMBL, BTN_THUMBR, KEY_VOLUMEDOWN, KEY_VOLUMEUP},
+                                    merge_codes(js_mapping.targets(EV_KEY),
+                                                merge_codes(fn_mapping.targets(EV_KEY), gesture_mapping.targets(EV_KEY))));
     auto gamepad_uidev = create_uinput_dev("Virtual XBox360", src_dev,
-                                           {{EV_KEY, {BTN_NORTH, BTN_SOUTH, BTN_WEST, BTN_EAST, BTN_TL, BTN_TR, BTN_SELECT, BTN_START, BTN_MODE, BTN_THUMBL, BTN_THUMBR, KEY_VOLUMEDOWN, KEY_VOLUMEUP}},
+                                           {{EV_KEY, gamepad_keys},
                                             {EV_SYN, {}},
                                             {EV_FF, {FF_RUMBLE, FF_PERIODIC, FF_SQUARE, FF_TRIANGLE, FF_SINE, FF_GAIN}}},
-                                           {{ABS_X, libevdev_get_abs_info(src_dev, ABS_X)},
-                                            {ABS_Y, libevdev_get_abs_info(src_dev, ABS_Y)},
-                                            {ABS_Z, libevdev_get_abs_info(src_dev, ABS_Z)},
-                                            {ABS_RX, libevdev_get_abs_info(src_dev, ABS_RX)},
-                                            {ABS_RY, libevdev_get_abs_info(src_dev, ABS_RY)},
-                                            {ABS_RZ, libevdev_get_abs_info(src_dev, ABS_RZ)},
-                                            {ABS_HAT0X, libevdev_get_abs_info(src_dev, ABS_HAT0X)},
-                                            {ABS_HAT0Y, libevdev_get_abs_info(src_dev, ABS_HAT0Y)}});
+                                           gamepad_absinfo);
 
     auto mouse_uidev = create_uinput_dev("Virtual Mouse", nullptr,
-                                         {{EV_KEY, {BTN_LEFT, BTN_MIDDLE, BTN_RIGHT}},
+                                         {{EV_KEY, merge_codes({BTN_LEFT, BTN_MIDDLE, BTN_RIGHT}, mouse_mapping.targets(EV_KEY))},
                                           {EV_SYN, {}},
-                                          {EV_REL, {REL_X, REL_Y, REL_WHEEL, REL_WHEEL_HI_RES}}},
+                                          {EV_REL, merge_codes({REL_X, REL_Y, REL_WHEEL, REL_WHEEL_HI_RES},
+                                                               merge_codes(mouse_mapping.targets(EV_REL), js_mapping.targets(EV_REL)))}},
                                          {});
 
-    // init IMU with filter, wait one sec to let IMU finish self-calib
-    IMU *imu = new IMU();
-    sleep(1);
-    int rc = 1;
-    float scale_factor = 50000;
+    // companion device with raw motion axes, same id as the gamepad so that
+    // consumers can pair them, accel in ABS_X/Y/Z and gyro in ABS_RX/RY/RZ
+    input_absinfo accel_absinfo = {0, -4 * MOTION_ACCEL_RES_PER_G, 4 * MOTION_ACCEL_RES_PER_G, 4, 0, MOTION_ACCEL_RES_PER_G};
+    input_absinfo gyro_absinfo = {0, -2000 * MOTION_GYRO_RES_PER_DPS, 2000 * MOTION_GYRO_RES_PER_DPS, 16, 0, MOTION_GYRO_RES_PER_DPS};
+    auto motion_uidev = create_uinput_dev("Virtual XBox360 Motion Sensors", src_dev,
+                                          {{EV_SYN, {}},
+                                           {EV_MSC, {MSC_TIMESTAMP}}},
+                                          {{ABS_X, &accel_absinfo},
+                                           {ABS_Y, &accel_absinfo},
+                                           {ABS_Z, &accel_absinfo},
+                                           {ABS_RX, &gyro_absinfo},
+                                           {ABS_RY, &gyro_absinfo},
+                                           {ABS_RZ, &gyro_absinfo}},
+                                          {INPUT_PROP_ACCELEROMETER});
+
+    // backend is picked once at startup, [imu] changes need a restart
+    auto imu_placement = profile->imu_placement();
+    IMU *imu = IMU::create(config->imu_backend, config->imu_device, imu_placement);
+    if (imu == nullptr)
+    {
+        std::cout << "imu backend " << config->imu_backend << " err!" << std::endl;
+        imu = new BasicIMU<Bmi160Backend>(imu_placement.bus.empty() ? I2C_BUS_PATH : imu_placement.bus, imu_placement.addr);
+        imu->setAxisRemap(imu_placement.axes);
+    }
+
+    auto uinput_handler = UInput(src_dev, fn_dev, imu, gamepad_uidev, mouse_uidev, motion_uidev);
+    uinput_handler.set_config(config);
+    // reload on change, output devices keep the codes enabled at startup
+    auto config_watcher = ConfigWatcher(config_path, src_dev, fn_dev,
+                                        [&uinput_handler](Config *new_config)
+                                        { uinput_handler.set_config(new_config); });
+
+    // --control <path>, runtime control socket
+    std::string control_path = DEFAULT_CONTROL_PATH;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::string(argv[i]) == "--control")
+            control_path = argv[i + 1];
+    }
+    auto control_server = ControlServer(control_path, &uinput_handler, imu);
+
+    // fused motion for local tools, see motion_shm.hpp for the layout
+    auto motion_shm = new MotionShmWriter();
+    if (motion_shm->is_open())
+        imu->addListener([motion_shm](const MotionSample &sample)
+                         { motion_shm->on_motion_sample(sample); });
 
-    auto uinput_handler = UInput(src_dev, fn_dev, imu, gamepad_uidev, mouse_uidev, 9000);
+    // optional cemuhook server for emulators: --dsu [port]
+    DsuServer *dsu_server = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) != "--dsu")
+            continue;
+        int port = DSU_DEFAULT_PORT;
+        if (i + 1 < argc && isdigit(argv[i + 1][0]))
+            port = atoi(argv[i + 1]);
+        dsu_server = new DsuServer(imu, port);
+        if (dsu_server->is_open())
+        {
+            imu->addListener([dsu_server](const MotionSample &sample)
+                             { dsu_server->on_motion_sample(sample); });
+            imu->addTickListener([dsu_server]()
+                                 { dsu_server->on_tick(); });
+        }
+    }
+    imu->start();
     uinput_handler.run();
 }
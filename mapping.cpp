@@ -0,0 +1,244 @@
+#include "mapping.hpp"
+#include "device_profile.hpp"
+#include "imu/imu_backend.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+Mapping::Mapping(MappingAction default_action)
+{
+  for (auto &entry : entries)
+    entry = MappingEntry{default_action, 0, 0, 0};
+}
+
+void Mapping::set(int type, int code, MappingEntry entry)
+{
+  if (type == EV_KEY && code < KEY_CNT)
+    entries[KEY_BASE + code] = entry;
+  else if (type == EV_ABS && code < ABS_CNT)
+    entries[ABS_BASE + code] = entry;
+}
+
+/*
+resolve names like BTN_SOUTH, -1 if unknown or of another type
+*/
+static int code_from_name(int type, const std::string &name)
+{
+  if (libevdev_event_type_from_code_name(name.c_str()) != type)
+    return -1;
+  return libevdev_event_code_from_code_name(name.c_str());
+}
+
+bool Mapping::parse_entry(const std::string &src, const std::string &value, libevdev *src_dev)
+{
+  auto src_type = libevdev_event_type_from_code_name(src.c_str());
+  auto src_code = libevdev_event_code_from_code_name(src.c_str());
+  if ((src_type != EV_KEY && src_type != EV_ABS) || src_code < 0)
+  {
+    std::cout << "mapping: unknown source " << src << std::endl;
+    return false;
+  }
+  if (src_dev != nullptr && !libevdev_has_event_code(src_dev, src_type, src_code))
+  {
+    std::cout << "mapping: " << src << " not supported by " << libevdev_get_name(src_dev) << std::endl;
+    return false;
+  }
+
+  std::vector<std::string> args;
+  std::stringstream ss(value);
+  std::string arg;
+  while (std::getline(ss, arg, ':'))
+    args.push_back(arg);
+  if (args.empty())
+    return false;
+
+  // a bare code name is a plain remap
+  if (args.size() == 1 && libevdev_event_type_from_code_name(args[0].c_str()) >= 0)
+    args = {src_type == EV_KEY ? "key" : "abs", args[0]};
+  auto kind = args[0];
+
+  MappingEntry entry = {MAP_NONE, 0, 0, 0};
+  if (kind == "none" && args.size() == 1)
+    entry.action = MAP_NONE;
+  else if (kind == "pass" && args.size() == 1)
+    entry.action = MAP_PASS;
+  else if (kind == "wheel" && args.size() == 1 && src_type == EV_ABS)
+    entry = {MAP_WHEEL, REL_WHEEL, 0, 0};
+  else if (kind == "fn_left" && args.size() == 1 && src_type == EV_KEY)
+    entry.action = MAP_FN_LEFT;
+  else if (kind == "fn_right" && args.size() == 1 && src_type == EV_KEY)
+    entry.action = MAP_FN_RIGHT;
+  else if (kind == "gyro_toggle" && args.size() == 1 && src_type == EV_KEY)
+    entry.action = MAP_GYRO_TOGGLE;
+  else if (kind == "key" && args.size() == 2 && src_type == EV_KEY)
+    entry = {MAP_KEY, static_cast<uint16_t>(code_from_name(EV_KEY, args[1])), 0, 0};
+  else if (kind == "abs" && args.size() == 2 && src_type == EV_ABS)
+    entry = {MAP_ABS, static_cast<uint16_t>(code_from_name(EV_ABS, args[1])), 0, 0};
+  else if (kind == "rel" && args.size() == 2 && src_type == EV_ABS)
+    entry = {MAP_REL, static_cast<uint16_t>(code_from_name(EV_REL, args[1])), 0, 0};
+  else if (kind == "axis_key" && args.size() == 3 && src_type == EV_ABS)
+    entry = {MAP_AXIS_KEY, static_cast<uint16_t>(code_from_name(EV_KEY, args[1])), 0, atoi(args[2].c_str())};
+  else if (kind == "macro" && args.size() == 2 && src_type == EV_KEY)
+  {
+    std::vector<uint16_t> keys;
+    std::stringstream keys_ss(args[1]);
+    while (std::getline(keys_ss, arg, '+'))
+    {
+      auto code = code_from_name(EV_KEY, arg);
+      if (code < 0)
+      {
+        std::cout << "mapping: unknown key " << arg << " in " << src << std::endl;
+        return false;
+      }
+      keys.push_back(code);
+    }
+    if (keys.empty())
+      return false;
+    macros.push_back(keys);
+    entry = {MAP_MACRO, 0, static_cast<uint16_t>(macros.size() - 1), 0};
+  }
+  else
+  {
+    std::cout << "mapping: invalid action " << value << " for " << src << std::endl;
+    return false;
+  }
+  // code_from_name failed
+  if (entry.code == static_cast<uint16_t>(-1))
+  {
+    std::cout << "mapping: unknown target " << value << " for " << src << std::endl;
+    return false;
+  }
+  // output axes copy their absinfo from the source device
+  if (entry.action == MAP_ABS && src_dev != nullptr && !libevdev_has_event_code(src_dev, EV_ABS, entry.code))
+  {
+    std::cout << "mapping: target " << value << " not supported by " << libevdev_get_name(src_dev) << std::endl;
+    return false;
+  }
+  set(src_type, src_code, entry);
+  return true;
+}
+
+bool Mapping::load(GKeyFile *key_file, const char *group, libevdev *src_dev)
+{
+  if (!g_key_file_has_group(key_file, group))
+    return true;
+  gsize length = 0;
+  auto keys = g_key_file_get_keys(key_file, group, &length, NULL);
+  bool ok = true;
+  for (gsize i = 0; i < length; i++)
+  {
+    auto value = g_key_file_get_string(key_file, group, keys[i], NULL);
+    if (value == NULL || !parse_entry(keys[i], value, src_dev))
+      ok = false;
+    g_free(value);
+  }
+  g_strfreev(keys);
+  return ok;
+}
+
+// in IMU_GESTURE_* bit order
+static const char *gesture_names[IMU_GESTURE_COUNT] = {"tap", "double_tap", "high_g", "orientation", "flat"};
+
+/*
+gesture names are turned into their virtual key's name, the entries are
+parsed like any key's
+*/
+bool Mapping::load_gestures(GKeyFile *key_file, const char *group)
+{
+  if (!g_key_file_has_group(key_file, group))
+    return true;
+  gsize length = 0;
+  auto keys = g_key_file_get_keys(key_file, group, &length, NULL);
+  bool ok = true;
+  for (gsize i = 0; i < length; i++)
+  {
+    auto gesture = std::find(gesture_names, gesture_names + IMU_GESTURE_COUNT, std::string(keys[i])) - gesture_names;
+    auto value = g_key_file_get_string(key_file, group, keys[i], NULL);
+    if (gesture == IMU_GESTURE_COUNT)
+    {
+      std::cout << "mapping: unknown gesture " << keys[i] << std::endl;
+      ok = false;
+    }
+    else if (value == NULL || !parse_entry(libevdev_event_code_get_name(EV_KEY, GESTURE_KEY_BASE + gesture), value, nullptr))
+      ok = false;
+    g_free(value);
+  }
+  g_strfreev(keys);
+  return ok;
+}
+
+bool Mapping::is_bound() const
+{
+  for (const auto &entry : entries)
+  {
+    if (entry.action != MAP_NONE)
+      return true;
+  }
+  return false;
+}
+
+std::vector<int> Mapping::targets(int type) const
+{
+  std::vector<int> codes;
+  for (const auto &entry : entries)
+  {
+    switch (entry.action)
+    {
+    case MAP_KEY:
+    case MAP_AXIS_KEY:
+      if (type == EV_KEY)
+        codes.push_back(entry.code);
+      break;
+    case MAP_ABS:
+      if (type == EV_ABS)
+        codes.push_back(entry.code);
+      break;
+    case MAP_REL:
+    case MAP_WHEEL:
+      if (type == EV_REL)
+        codes.push_back(entry.code);
+      break;
+    case MAP_MACRO:
+      if (type == EV_KEY)
+        codes.insert(codes.end(), macros[entry.macro].begin(), macros[entry.macro].end());
+      break;
+    default:
+      break;
+    }
+  }
+  return codes;
+}
+
+Mapping Mapping::default_js()
+{
+  return Mapping(MAP_PASS);
+}
+
+Mapping Mapping::default_mouse()
+{
+  Mapping mapping(MAP_NONE);
+  mapping.set(EV_KEY, BTN_SOUTH, {MAP_KEY, BTN_LEFT, 0, 0});
+  mapping.set(EV_KEY, BTN_EAST, {MAP_KEY, BTN_RIGHT, 0, 0});
+  mapping.set(EV_KEY, BTN_WEST, {MAP_KEY, BTN_MIDDLE, 0, 0});
+  mapping.set(EV_ABS, ABS_X, {MAP_REL, REL_X, 0, 0});
+  mapping.set(EV_ABS, ABS_Y, {MAP_REL, REL_Y, 0, 0});
+  mapping.set(EV_ABS, ABS_RY, {MAP_WHEEL, REL_WHEEL, 0, 0});
+  return mapping;
+}
+
+Mapping Mapping::default_fn()
+{
+  Mapping mapping(MAP_NONE);
+  const auto &profile = device_profile();
+  mapping.set(EV_KEY, profile.fn_left, {MAP_FN_LEFT, 0, 0, 0});
+  mapping.set(EV_KEY, profile.fn_right, {MAP_FN_RIGHT, 0, 0, 0});
+  mapping.set(EV_KEY, KEY_VOLUMEDOWN, {MAP_PASS, 0, 0, 0});
+  mapping.set(EV_KEY, KEY_VOLUMEUP, {MAP_PASS, 0, 0, 0});
+  return mapping;
+}
+
+// nothing bound, the accelerometer is not kept running for gestures
+Mapping Mapping::default_gestures()
+{
+  return Mapping(MAP_NONE);
+}
@@ -0,0 +1,81 @@
+#ifndef MAPPING_HEADER
+#define MAPPING_HEADER
+#include <glib.h>
+#include <linux/input.h>
+#include <libevdev/libevdev.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum MappingAction : uint8_t
+{
+    MAP_NONE = 0,     // drop the event
+    MAP_PASS,         // forward unchanged
+    MAP_KEY,          // button remap, key:CODE
+    MAP_ABS,          // axis remap, abs:CODE
+    MAP_REL,          // axis -> pointer/scroll motion sent every tick, rel:CODE
+    MAP_WHEEL,        // axis -> hi-res scrolling at its deflection every tick, wheel
+    MAP_AXIS_KEY,     // axis -> key past a threshold, axis_key:CODE:THRESHOLD
+    MAP_MACRO,        // key press -> key sequence, macro:CODE+CODE+...
+    MAP_FN_LEFT,      // left fn button gestures
+    MAP_FN_RIGHT,     // right fn button gestures
+    MAP_GYRO_TOGGLE,  // key press turns gyro aiming on/off, gyro_toggle
+};
+
+// IMU gestures are mapped as these virtual keys, gesture i is
+// GESTURE_KEY_BASE + i, named in the [gestures] group
+#define GESTURE_KEY_BASE (BTN_TRIGGER_HAPPY1)
+
+struct MappingEntry
+{
+    MappingAction action;
+    uint16_t code;
+    uint16_t macro;
+    int32_t threshold;
+};
+
+/*
+Mapping of one input device in one mode, compiled into a flat table
+indexed by (type, code). Only EV_KEY and EV_ABS are mappable.
+*/
+class Mapping
+{
+private:
+    static constexpr int KEY_BASE = 0;
+    static constexpr int ABS_BASE = KEY_CNT;
+    MappingEntry entries[KEY_CNT + ABS_CNT];
+    std::vector<std::vector<uint16_t>> macros;
+
+    bool parse_entry(const std::string &src, const std::string &value, libevdev *src_dev);
+
+public:
+    Mapping(MappingAction default_action = MAP_NONE);
+
+    const MappingEntry &lookup(int type, int code) const
+    {
+        static const MappingEntry none = {MAP_NONE, 0, 0, 0};
+        if (type == EV_KEY && code < KEY_CNT)
+            return entries[KEY_BASE + code];
+        if (type == EV_ABS && code < ABS_CNT)
+            return entries[ABS_BASE + code];
+        return none;
+    }
+    const std::vector<uint16_t> &get_macro(int index) const { return macros[index]; }
+
+    void set(int type, int code, MappingEntry entry);
+    // entries of the group override the current table, false on any invalid entry
+    bool load(GKeyFile *key_file, const char *group, libevdev *src_dev);
+    // the same with gesture names as keys
+    bool load_gestures(GKeyFile *key_file, const char *group);
+    // true if any event is mapped to an action
+    bool is_bound() const;
+    // codes of type the mapping can emit, to enable them on the output device
+    std::vector<int> targets(int type) const;
+
+    static Mapping default_js();
+    static Mapping default_mouse();
+    static Mapping default_fn();
+    static Mapping default_gestures();
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "motion_shm.hpp"
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <iostream>
+
+MotionShmWriter::MotionShmWriter() : shm(nullptr)
+{
+  // recreate so that readers never see a layout from an older version
+  shm_unlink(MOTION_SHM_NAME);
+  int fd = shm_open(MOTION_SHM_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    std::cout << "motion shm open err!" << std::endl;
+    return;
+  }
+  if (ftruncate(fd, sizeof(MotionShm)) != 0)
+  {
+    std::cout << "motion shm resize err!" << std::endl;
+    close(fd);
+    return;
+  }
+  auto addr = mmap(NULL, sizeof(MotionShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+  {
+    std::cout << "motion shm map err!" << std::endl;
+    return;
+  }
+  // fresh mapping is zero filled, publish the header last
+  shm = static_cast<MotionShm *>(addr);
+  shm->version = MOTION_SHM_VERSION;
+  shm->slot_count = MOTION_SHM_SLOTS;
+  shm->sample_size = sizeof(MotionShmSample);
+  std::atomic_thread_fence(std::memory_order_release);
+  shm->magic = MOTION_SHM_MAGIC;
+}
+
+MotionShmWriter::~MotionShmWriter()
+{
+  if (shm != nullptr)
+  {
+    munmap(shm, sizeof(MotionShm));
+    shm_unlink(MOTION_SHM_NAME);
+  }
+}
+
+/*
+called on the IMU sampling thread, the only writer of the segment
+*/
+void MotionShmWriter::on_motion_sample(const MotionSample &sample)
+{
+  auto index = shm->write_index.load(std::memory_order_relaxed);
+  auto &slot = shm->slots[index % MOTION_SHM_SLOTS];
+  auto seq = slot.seq.load(std::memory_order_relaxed);
+
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  slot.sample.timestamp_us = static_cast<uint64_t>(sample.timestamp * 1e6);
+  slot.sample.monotonic_ns = now.tv_sec * 1000000000ull + now.tv_nsec;
+  slot.sample.quat_w = sample.quat_w;
+  slot.sample.quat_x = sample.quat_x;
+  slot.sample.quat_y = sample.quat_y;
+  slot.sample.quat_z = sample.quat_z;
+  slot.sample.grav_x = sample.grav_x;
+  slot.sample.grav_y = sample.grav_y;
+  slot.sample.grav_z = sample.grav_z;
+  slot.sample.gyro_x = sample.gyro_x;
+  slot.sample.gyro_y = sample.gyro_y;
+  slot.sample.gyro_z = sample.gyro_z;
+
+  slot.seq.store(seq + 2, std::memory_order_release);
+  shm->write_index.store(index + 1, std::memory_order_release);
+}
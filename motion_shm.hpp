@@ -0,0 +1,83 @@
+#ifndef MOTION_SHM_HEADER
+#define MOTION_SHM_HEADER
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include "imu/imu.h"
+
+/*
+Shared memory export of the fused motion state.
+
+Readers shm_open(MOTION_SHM_NAME, O_RDONLY) and mmap sizeof(MotionShm).
+Every slot of the ring is protected by its own seqlock: seq is odd while
+the writer is inside the slot, a reader retries when seq is odd or changed
+while copying. write_index counts published samples, the newest one lives
+in slots[(write_index - 1) % MOTION_SHM_SLOTS].
+*/
+#define MOTION_SHM_NAME "/oxp-gyro-motion"
+#define MOTION_SHM_MAGIC (0x4d50584f) // "OXPM"
+#define MOTION_SHM_VERSION (1)
+#define MOTION_SHM_SLOTS (64)
+
+struct MotionShmSample
+{
+    uint64_t timestamp_us; // sensortime based
+    uint64_t monotonic_ns; // CLOCK_MONOTONIC when published
+    float quat_w, quat_x, quat_y, quat_z;
+    float grav_x, grav_y, grav_z;
+    float gyro_x, gyro_y, gyro_z;
+};
+
+struct alignas(64) MotionShmSlot
+{
+    std::atomic<uint32_t> seq;
+    MotionShmSample sample;
+};
+
+struct MotionShm
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t sample_size;
+    alignas(64) std::atomic<uint64_t> write_index;
+    MotionShmSlot slots[MOTION_SHM_SLOTS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+              std::atomic<uint64_t>::is_always_lock_free);
+
+/*
+lock free read of the newest sample, false if nothing was published yet
+*/
+inline bool motion_shm_read_latest(const MotionShm *shm, MotionShmSample &out)
+{
+    while (true)
+    {
+        auto index = shm->write_index.load(std::memory_order_acquire);
+        if (index == 0)
+            return false;
+        auto &slot = shm->slots[(index - 1) % MOTION_SHM_SLOTS];
+        auto seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        memcpy(&out, &slot.sample, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == seq)
+            return true;
+    }
+}
+
+class MotionShmWriter
+{
+private:
+    MotionShm *shm;
+
+public:
+    MotionShmWriter();
+    ~MotionShmWriter();
+    bool is_open() { return shm != nullptr; }
+    void on_motion_sample(const MotionSample &sample);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "pointer.hpp"
+#include "uinput.hpp"
+
+void PointerEngine::reset()
+{
+  axes.fill(0);
+  remainder.fill(0);
+  wheel = 0;
+  wheel_remainder = 0;
+  wheel_hi_res = 0;
+}
+
+float PointerEngine::rescale(float deflection, float deadzone)
+{
+  if (deflection <= deadzone)
+    return 0;
+  return fmin((deflection - deadzone) / (POINTER_STICK_MAX - deadzone), 1.0f) * POINTER_STICK_MAX;
+}
+
+void PointerEngine::move(int code, float speed, float dt, std::vector<Event> &event_queue)
+{
+  remainder[code] += speed * dt / POINTER_CURVE_TICK_S;
+  int pixels = static_cast<int>(remainder[code]);
+  if (pixels == 0)
+    return;
+  remainder[code] -= pixels;
+  event_queue.emplace_back(Event(EV_REL, code, pixels));
+}
+
+bool PointerEngine::tick(const Config &config, float dt, std::vector<Event> &event_queue)
+{
+  bool moving = false;
+  const auto &curve = config.mouse_curve;
+
+  // radial deadzone, the curve is applied to the length so diagonals
+  // are as fast as straight moves
+  float norm = hypot(axes[REL_X], axes[REL_Y]);
+  float scaled = rescale(norm, config.pointer_deadzone);
+  if (scaled > 0)
+  {
+    float speed = curve(scaled);
+    move(REL_X, speed * axes[REL_X] / norm, dt, event_queue);
+    move(REL_Y, speed * axes[REL_Y] / norm, dt, event_queue);
+    moving = true;
+  }
+  else
+  {
+    remainder[REL_X] = 0;
+    remainder[REL_Y] = 0;
+  }
+
+  // any other REL target mapped from a stick
+  for (int code = REL_Y + 1; code < REL_CNT; code++)
+  {
+    if (axes[code] == 0)
+      continue;
+    scaled = rescale(abs(axes[code]), config.pointer_deadzone);
+    if (scaled > 0)
+    {
+      move(code, copysign(curve(scaled), axes[code]), dt, event_queue);
+      moving = true;
+    }
+    else
+      remainder[code] = 0;
+  }
+
+  // stick up scrolls up, speed grows linearly with the deflection
+  scaled = rescale(abs(wheel), config.pointer_deadzone);
+  if (scaled > 0)
+  {
+    float speed = -copysign(scaled / POINTER_STICK_MAX * config.scroll_speed * POINTER_HI_RES_PER_DETENT, wheel);
+    wheel_remainder += speed * dt;
+    int hi_res = static_cast<int>(wheel_remainder);
+    if (hi_res != 0)
+    {
+      wheel_remainder -= hi_res;
+      wheel_hi_res += hi_res;
+      event_queue.emplace_back(Event(EV_REL, REL_WHEEL_HI_RES, hi_res));
+      int detents = wheel_hi_res / POINTER_HI_RES_PER_DETENT;
+      if (detents != 0)
+      {
+        wheel_hi_res -= detents * POINTER_HI_RES_PER_DETENT;
+        event_queue.emplace_back(Event(EV_REL, REL_WHEEL, detents));
+      }
+    }
+    moving = true;
+  }
+  else
+  {
+    wheel_remainder = 0;
+    wheel_hi_res = 0;
+  }
+  return moving;
+}
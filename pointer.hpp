@@ -0,0 +1,48 @@
+#ifndef POINTER_HEADER
+#define POINTER_HEADER
+#include <linux/input.h>
+#include <math.h>
+#include <array>
+#include <vector>
+#include "config.hpp"
+
+// full stick deflection
+#define POINTER_STICK_MAX (32768.0f)
+// pointer curves are in pixels per 10ms, scaled by the real elapsed time
+#define POINTER_CURVE_TICK_S (0.01f)
+// REL_WHEEL_HI_RES units per wheel detent
+#define POINTER_HI_RES_PER_DETENT (120)
+
+struct Event;
+
+/*
+Turns stick deflection into pointer motion and scrolling. Driven by a
+timer at any rate, every tick moves by speed * elapsed time and keeps the
+sub-pixel remainder, so slow deflections still move and the speed does
+not depend on the tick rate. X/Y share a radial deadzone, the wheel is
+scrolled in hi-res units with legacy REL_WHEEL detents on top.
+*/
+class PointerEngine
+{
+private:
+    // last stick value per REL target
+    std::array<int, REL_CNT> axes{};
+    std::array<float, REL_CNT> remainder{};
+    int wheel = 0;
+    float wheel_remainder = 0;
+    // hi-res units sent since the last full detent
+    int wheel_hi_res = 0;
+
+    // deflection outside the deadzone rescaled to 0..POINTER_STICK_MAX
+    static float rescale(float deflection, float deadzone);
+    void move(int code, float speed, float dt, std::vector<Event> &event_queue);
+
+public:
+    void set_axis(int code, int value) { axes[code] = value; };
+    void set_wheel(int value) { wheel = value; };
+    void reset();
+    // queue events for dt seconds of motion, false once the sticks rest
+    bool tick(const Config &config, float dt, std::vector<Event> &event_queue);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include "smoothing.hpp"
+#include <algorithm>
+
+void OneEuroSmoother::filter(float &x, float &y, float dt)
+{
+  if (!initialized || dt <= 0)
+  {
+    prev_x = x;
+    prev_y = y;
+    dx = dy = 0;
+    initialized = true;
+    return;
+  }
+  // smoothed rate of change decides the cutoff
+  auto a_d = alpha(d_cutoff, dt);
+  dx += a_d * ((x - prev_x) / dt - dx);
+  dy += a_d * ((y - prev_y) / dt - dy);
+  auto cutoff = min_cutoff + beta * sqrtf(dx * dx + dy * dy);
+
+  auto a = alpha(cutoff, dt);
+  x = prev_x + a * (x - prev_x);
+  y = prev_y + a * (y - prev_y);
+  prev_x = x;
+  prev_y = y;
+}
+
+void SoftTierSmoother::filter(float &x, float &y, float dt)
+{
+  // only the part below the threshold goes through the smoothing buffer
+  auto speed = sqrtf(x * x + y * y);
+  auto direct = std::clamp((speed - threshold / 2) / (threshold / 2), 0.0f, 1.0f);
+  auto a = 1.0f - expf(-dt / tau);
+  smooth_x += a * (x * (1 - direct) - smooth_x);
+  smooth_y += a * (y * (1 - direct) - smooth_y);
+  x = x * direct + smooth_x;
+  y = y * direct + smooth_y;
+}
+
+std::unique_ptr<Smoother> make_smoother(const std::string &name)
+{
+  if (name == "none")
+    return std::make_unique<NoSmoother>();
+  if (name == "one-euro")
+    return std::make_unique<OneEuroSmoother>();
+  if (name == "soft-tier")
+    return std::make_unique<SoftTierSmoother>();
+  return nullptr;
+}
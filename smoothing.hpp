@@ -0,0 +1,73 @@
+#ifndef SMOOTHING_HEADER
+#define SMOOTHING_HEADER
+#include <math.h>
+#include <memory>
+#include <string>
+
+/*
+Smoothing stage between IMU::getMotion and the stick mapping.
+Filters work on angular velocity (dps) with the real elapsed time, so
+their behaviour does not depend on the update rate.
+*/
+class Smoother
+{
+public:
+    virtual ~Smoother(){};
+    virtual void filter(float &x, float &y, float dt) = 0;
+    virtual void reset(){};
+};
+
+class NoSmoother : public Smoother
+{
+public:
+    void filter(float &x, float &y, float dt) override{};
+};
+
+/*
+One Euro filter (Casiez et al.), cutoff rises with the rate of change so
+fast flicks pass through while jitter at rest is filtered at min_cutoff.
+The cutoff is shared by both axes to keep the direction intact.
+*/
+class OneEuroSmoother : public Smoother
+{
+private:
+    float min_cutoff, beta, d_cutoff;
+    bool initialized = false;
+    float prev_x, prev_y;
+    float dx = 0, dy = 0;
+
+    static float alpha(float cutoff, float dt)
+    {
+        auto tau = 1.0f / (2 * M_PI * cutoff);
+        return 1.0f / (1.0f + tau / dt);
+    }
+
+public:
+    OneEuroSmoother(float min_cutoff = 1.5, float beta = 0.01, float d_cutoff = 1.0)
+        : min_cutoff(min_cutoff), beta(beta), d_cutoff(d_cutoff){};
+    void filter(float &x, float &y, float dt) override;
+    void reset() override { initialized = false; };
+};
+
+/*
+Soft tier smoothing, small velocities (below threshold / 2) are fully
+smoothed with time constant tau, velocities above threshold are passed
+through untouched, blended linearly in between.
+*/
+class SoftTierSmoother : public Smoother
+{
+private:
+    float threshold, tau;
+    float smooth_x = 0, smooth_y = 0;
+
+public:
+    SoftTierSmoother(float threshold = 5.0, float tau = 0.1)
+        : threshold(threshold), tau(tau){};
+    void filter(float &x, float &y, float dt) override;
+    void reset() override { smooth_x = smooth_y = 0; };
+};
+
+// "none", "one-euro" or "soft-tier", nullptr for unknown names
+std::unique_ptr<Smoother> make_smoother(const std::string &name);
+
+#endif
@@ -0,0 +1,84 @@
+#include "bmi26x_backend.h"
+#include "bmi26x_sim.h"
+#include "sim_backend.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#define TEST_READINGS (200)
+// one lsb of the gyro at 2000dps and of the accel at 2g, plus rounding
+#define TEST_GYRO_TOLERANCE (0.1f)
+#define TEST_ACCEL_TOLERANCE (0.001f)
+
+static float reading_error(const ImuReading &reading, double seconds)
+{
+    ImuReading expected;
+    SimBackend::motion(seconds, expected);
+    float gyro = std::max({fabsf(reading.gyro_x - expected.gyro_x),
+                           fabsf(reading.gyro_y - expected.gyro_y),
+                           fabsf(reading.gyro_z - expected.gyro_z)});
+    float accel = std::max({fabsf(reading.accel_x - expected.accel_x),
+                            fabsf(reading.accel_y - expected.accel_y),
+                            fabsf(reading.accel_z - expected.accel_z)});
+    return std::max(gyro / TEST_GYRO_TOLERANCE, accel / TEST_ACCEL_TOLERANCE);
+}
+
+/*
+the BMI26x driver against the register level simulator: reset, config
+upload and init status, sensor setup and FIFO reads. Every decoded
+reading has to be the simulator's signal at its timestamp. Timestamps
+start at the first sample, the sensortime of that sample is searched.
+*/
+int main()
+{
+    auto start = std::chrono::steady_clock::now();
+    Bmi26xBackend<Bmi26xSimBus> backend(std::vector<uint8_t>(BMI26X_CONFIG_SIZE));
+    if (!backend.isOpen())
+    {
+        std::cout << "bmi26x sim open err!" << std::endl;
+        return 1;
+    }
+
+    ImuReading readings[TEST_READINGS];
+    size_t count = 0;
+    while (count < TEST_READINGS)
+        count += backend.read(readings + count, TEST_READINGS - count);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        auto step = readings[i].timestamp - readings[i - 1].timestamp;
+        if (step != 1000000000LL / 200)
+        {
+            std::cout << "reading " << i << " " << step << "ns after the previous one" << std::endl;
+            failed++;
+        }
+    }
+
+    double best_start = 0;
+    float best_error = INFINITY;
+    for (double first = 0; first < elapsed; first += BMI26X_SIM_TICK_NS / 1e9)
+    {
+        float error = 0;
+        for (size_t i = 0; i < count && error < best_error; i++)
+            error = std::max(error, reading_error(readings[i], first + readings[i].timestamp / 1e9));
+        if (error < best_error)
+        {
+            best_error = error;
+            best_start = first;
+        }
+    }
+    if (best_error > 1)
+    {
+        std::cout << "readings off the signal by " << best_error << " tolerances, first at " << best_start << "s" << std::endl;
+        failed++;
+    }
+    if (backend.getHealth().bus_errors != 0 || backend.getHealth().overflows != 0)
+    {
+        std::cout << "bmi26x sim bus errors or overflows" << std::endl;
+        failed++;
+    }
+    return failed > 0;
+}
@@ -0,0 +1,136 @@
+#include "dsu_server.hpp"
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_PORT (DSU_DEFAULT_PORT + 100)
+#define TEST_CLIENTS (2)
+#define TEST_SAMPLES (50)
+// samples per read, as a FIFO backend delivers them
+#define TEST_READ_SAMPLES (5)
+
+static bool check_crc(uint8_t *packet, size_t size)
+{
+    DsuHeader header;
+    memcpy(&header, packet, sizeof(header));
+    memset(packet + offsetof(DsuHeader, crc32), 0, sizeof(header.crc32));
+    return dsu_crc32(packet, size) == header.crc32;
+}
+
+/* subscribe to all pads, like cemuhook clients do every few seconds */
+static void subscribe(int fd)
+{
+    struct __attribute__((packed))
+    {
+        DsuHeader header;
+        uint8_t flags;
+        uint8_t slot;
+        uint8_t mac[6];
+    } request = {};
+    memcpy(request.header.magic, "DSUC", 4);
+    request.header.version = DSU_PROTOCOL_VERSION;
+    request.header.length = sizeof(request) - offsetof(DsuHeader, msg_type);
+    request.header.msg_type = DSU_MSG_DATA;
+    request.header.crc32 = dsu_crc32(reinterpret_cast<uint8_t *>(&request), sizeof(request));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(fd, &request, sizeof(request), 0, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+}
+
+static MotionSample test_sample(int i)
+{
+    MotionSample sample = {};
+    sample.timestamp = i * 0.01;
+    sample.gyro_x = i;
+    sample.gyro_y = -i;
+    sample.gyro_z = i * 0.5f;
+    sample.accel_x = 0.1f;
+    sample.accel_y = -1;
+    sample.accel_z = i * 0.01f;
+    return sample;
+}
+
+/*
+the DSU server against local UDP clients: packets are held until the
+read's tick, then every subscriber gets one data packet per motion
+sample, with a valid crc, consecutive packet numbers and the sample's
+motion
+*/
+int main()
+{
+    IMU *imu = IMU::create("sim", "");
+    DsuServer server(imu, TEST_PORT);
+    if (!server.is_open())
+    {
+        std::cout << "dsu server open err!" << std::endl;
+        return 1;
+    }
+
+    int clients[TEST_CLIENTS];
+    for (auto &fd : clients)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        subscribe(fd);
+    }
+    server.on_read(nullptr, G_IO_IN);
+    int failed = 0;
+    for (int i = 0; i < TEST_SAMPLES; i++)
+    {
+        server.on_motion_sample(test_sample(i));
+        uint8_t buf[256];
+        if (i == 0 && recv(clients[0], buf, sizeof(buf), 0) > 0)
+        {
+            std::cout << "packet sent before the tick" << std::endl;
+            failed++;
+        }
+        if (i % TEST_READ_SAMPLES == TEST_READ_SAMPLES - 1)
+            server.on_tick();
+    }
+
+    for (int c = 0; c < TEST_CLIENTS; c++)
+    {
+        uint8_t buf[256];
+        ssize_t rd;
+        int count = 0;
+        uint32_t first = 0;
+        while ((rd = recv(clients[c], buf, sizeof(buf), 0)) > 0)
+        {
+            DsuDataPacket packet;
+            if (rd != sizeof(packet) || !check_crc(buf, rd))
+            {
+                std::cout << "client " << c << " packet " << count << " bad size or crc" << std::endl;
+                failed++;
+                break;
+            }
+            memcpy(&packet, buf, sizeof(packet));
+            if (count == 0)
+                first = packet.packet_number;
+            auto expected = test_sample(count);
+            if (memcmp(packet.header.magic, "DSUS", 4) != 0 ||
+                packet.header.msg_type != DSU_MSG_DATA ||
+                packet.packet_number != first + count ||
+                packet.motion_timestamp != static_cast<uint64_t>(expected.timestamp * 1e6) ||
+                packet.gyro_pitch != expected.gyro_y ||
+                packet.gyro_yaw != expected.gyro_x ||
+                packet.gyro_roll != expected.gyro_z ||
+                packet.accel_x != expected.accel_x ||
+                packet.accel_y != expected.accel_y ||
+                packet.accel_z != expected.accel_z)
+            {
+                std::cout << "client " << c << " packet " << count << " content differs" << std::endl;
+                failed++;
+            }
+            count++;
+        }
+        if (count != TEST_SAMPLES)
+        {
+            std::cout << "client " << c << " got " << count << " packets, expected " << TEST_SAMPLES << std::endl;
+            failed++;
+        }
+        close(clients[c]);
+    }
+    delete imu;
+    return failed > 0;
+}
@@ -0,0 +1,288 @@
+#include "ff_bridge.hpp"
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ctest reports this as skipped, for machines without uinput access
+#define TEST_SKIP (77)
+#define TEST_STANDIN_EFFECTS (8)
+#define TEST_WAIT_MS (2000)
+
+// what the stand-in physical pad was asked to do
+struct StandinLog
+{
+    std::mutex lock;
+    std::vector<ff_effect> uploads;
+    std::vector<int> erases;
+    std::vector<std::pair<uint16_t, int32_t>> events;
+};
+
+/*
+a uinput device with rumble and gain, path is its evdev node once udev
+created it
+*/
+static int create_pad(const char *name, int effects, std::string &path)
+{
+    int fd = open("/dev/uinput", O_RDWR | O_NONBLOCK);
+    if (fd < 0)
+        return -1;
+    uinput_setup setup = {};
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+    setup.ff_effects_max = effects;
+    char sysname[64] = {};
+    if (ioctl(fd, UI_SET_EVBIT, EV_FF) < 0 ||
+        ioctl(fd, UI_SET_FFBIT, FF_RUMBLE) < 0 ||
+        ioctl(fd, UI_SET_FFBIT, FF_GAIN) < 0 ||
+        ioctl(fd, UI_DEV_SETUP, &setup) < 0 ||
+        ioctl(fd, UI_DEV_CREATE) < 0 ||
+        ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    auto sys_dir = std::filesystem::path("/sys/devices/virtual/input") / sysname;
+    for (int waited = 0; waited < TEST_WAIT_MS && path.empty(); waited += 10)
+    {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(sys_dir, error))
+        {
+            auto node = "/dev/input/" + entry.path().filename().string();
+            if (entry.path().filename().string().rfind("event", 0) == 0 && access(node.c_str(), R_OK | W_OK) == 0)
+                path = node;
+        }
+        if (path.empty())
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (path.empty())
+    {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* the physical pad's driver: accepts every effect and logs the requests */
+static void serve_standin(int fd, StandinLog &log, std::atomic<bool> &running)
+{
+    while (running)
+    {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0)
+            continue;
+        input_event ev;
+        while (read(fd, &ev, sizeof(ev)) == sizeof(ev))
+        {
+            if (ev.type == EV_UINPUT && ev.code == UI_FF_UPLOAD)
+            {
+                uinput_ff_upload up = {};
+                up.request_id = ev.value;
+                ioctl(fd, UI_BEGIN_FF_UPLOAD, &up);
+                {
+                    std::lock_guard<std::mutex> lock(log.lock);
+                    log.uploads.push_back(up.effect);
+                }
+                up.retval = 0;
+                ioctl(fd, UI_END_FF_UPLOAD, &up);
+            }
+            else if (ev.type == EV_UINPUT && ev.code == UI_FF_ERASE)
+            {
+                uinput_ff_erase er = {};
+                er.request_id = ev.value;
+                ioctl(fd, UI_BEGIN_FF_ERASE, &er);
+                {
+                    std::lock_guard<std::mutex> lock(log.lock);
+                    log.erases.push_back(er.effect_id);
+                }
+                er.retval = 0;
+                ioctl(fd, UI_END_FF_ERASE, &er);
+            }
+            else if (ev.type == EV_FF)
+            {
+                std::lock_guard<std::mutex> lock(log.lock);
+                log.events.push_back({ev.code, ev.value});
+            }
+        }
+    }
+}
+
+/* the mapper's read loop on the virtual pad's uinput fd */
+static void pump_bridge(int fd, FfBridge &bridge, std::atomic<bool> &running)
+{
+    while (running)
+    {
+        pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 10) <= 0)
+            continue;
+        input_event ev;
+        while (read(fd, &ev, sizeof(ev)) == sizeof(ev))
+            bridge.handle(ev);
+    }
+}
+
+/* a rumble effect as a game uploads it, the id it got or -1 */
+static int upload_rumble(int fd, int16_t id, uint16_t strong)
+{
+    ff_effect effect = {};
+    effect.type = FF_RUMBLE;
+    effect.id = id;
+    effect.u.rumble.strong_magnitude = strong;
+    effect.replay.length = 100;
+    if (ioctl(fd, EVIOCSFF, &effect) < 0)
+        return -1;
+    return effect.id;
+}
+
+static void send_ff(int fd, uint16_t code, int32_t value)
+{
+    input_event ev = {};
+    ev.type = EV_FF;
+    ev.code = code;
+    ev.value = value;
+    if (write(fd, &ev, sizeof(ev)) != sizeof(ev))
+        std::cout << "ff test write err!" << std::endl;
+}
+
+static bool wait_events(StandinLog &log, size_t count)
+{
+    for (int waited = 0; waited < TEST_WAIT_MS; waited += 10)
+    {
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            if (log.events.size() >= count)
+                return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+static int check(bool ok, const char *what)
+{
+    if (!ok)
+        std::cout << what << std::endl;
+    return ok ? 0 : 1;
+}
+
+/*
+the bridge between two uinput pads: a game uploads, plays, erases and
+re-uploads rumble on the virtual pad, the stand-in physical pad has to
+see the same requests under its own effect ids. One effect is uploaded
+to it directly first, so the ids of the two pads differ
+*/
+int main()
+{
+    std::string phys_path, virt_path;
+    int phys_ui = create_pad("ff bridge test physical", TEST_STANDIN_EFFECTS, phys_path);
+    if (phys_ui < 0)
+    {
+        std::cout << "uinput not available, skipped" << std::endl;
+        return TEST_SKIP;
+    }
+    int virt_ui = create_pad("ff bridge test virtual", FF_BRIDGE_MAX_EFFECTS, virt_path);
+    if (virt_ui < 0)
+    {
+        std::cout << "uinput not available, skipped" << std::endl;
+        ioctl(phys_ui, UI_DEV_DESTROY);
+        close(phys_ui);
+        return TEST_SKIP;
+    }
+    // uinput.cpp hands the bridge a blocking uinput fd
+    fcntl(virt_ui, F_SETFL, fcntl(virt_ui, F_GETFL) & ~O_NONBLOCK);
+
+    StandinLog log;
+    std::atomic<bool> standin_running = true;
+    std::thread standin(serve_standin, phys_ui, std::ref(log), std::ref(standin_running));
+    int phys_fd = open(phys_path.c_str(), O_RDWR);
+    int game_fd = open(virt_path.c_str(), O_RDWR);
+    int failed = 0;
+
+    failed += check(upload_rumble(phys_fd, -1, 0x0100) == 0, "direct upload did not get id 0");
+    {
+        FfBridge bridge(virt_ui, phys_fd);
+        std::atomic<bool> pump_running = true;
+        std::thread pump(pump_bridge, virt_ui, std::ref(bridge), std::ref(pump_running));
+
+        int first = upload_rumble(game_fd, -1, 0x1000);
+        int second = upload_rumble(game_fd, -1, 0x2000);
+        failed += check(first == 0 && second == 1, "virtual ids not 0 and 1");
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            failed += check(log.uploads.size() == 3 &&
+                                log.uploads[1].id == 1 && log.uploads[1].u.rumble.strong_magnitude == 0x1000 &&
+                                log.uploads[2].id == 2 && log.uploads[2].u.rumble.strong_magnitude == 0x2000,
+                            "uploads not on physical ids 1 and 2");
+        }
+
+        send_ff(game_fd, first, 1);
+        send_ff(game_fd, FF_GAIN, 0x8000);
+        send_ff(game_fd, second, 0);
+        failed += check(wait_events(log, 3), "play, gain and stop did not arrive");
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            failed += check(log.events.size() == 3 &&
+                                log.events[0] == std::make_pair<uint16_t, int32_t>(1, 1) &&
+                                log.events[1] == std::make_pair<uint16_t, int32_t>(FF_GAIN, 0x8000) &&
+                                log.events[2] == std::make_pair<uint16_t, int32_t>(2, 0),
+                            "play, gain and stop not translated");
+        }
+
+        // the kernel stops an effect before erasing it, on both pads
+        failed += check(ioctl(game_fd, EVIOCRMFF, first) == 0, "erase on the virtual pad failed");
+        failed += check(wait_events(log, 4), "stop before the erase did not arrive");
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            for (size_t i = 3; i < log.events.size(); i++)
+                failed += check(log.events[i] == std::make_pair<uint16_t, int32_t>(1, 0), "stop before the erase not translated");
+        }
+        int again = upload_rumble(game_fd, -1, 0x3000);
+        failed += check(upload_rumble(game_fd, second, 0x4000) == second, "update on the virtual pad failed");
+        failed += check(again == first, "re-upload did not reuse virtual id 0");
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            failed += check(log.erases.size() == 1 && log.erases[0] == 1, "erase not on physical id 1");
+            failed += check(log.uploads.size() == 5 &&
+                                log.uploads[3].id == 1 && log.uploads[3].u.rumble.strong_magnitude == 0x3000 &&
+                                log.uploads[4].id == 2 && log.uploads[4].u.rumble.strong_magnitude == 0x4000,
+                            "re-upload or update not on physical ids 1 and 2");
+        }
+        size_t played;
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            played = log.events.size();
+        }
+        send_ff(game_fd, again, 1);
+        failed += check(wait_events(log, played + 1), "play after re-upload did not arrive");
+        {
+            std::lock_guard<std::mutex> lock(log.lock);
+            failed += check(log.events.size() == played + 1 &&
+                                log.events.back() == std::make_pair<uint16_t, int32_t>(1, 1),
+                            "play after re-upload not translated");
+        }
+
+        // closing erases the game's effects, the bridge still has to answer
+        close(game_fd);
+        pump_running = false;
+        pump.join();
+    }
+
+    close(phys_fd);
+    standin_running = false;
+    standin.join();
+    ioctl(virt_ui, UI_DEV_DESTROY);
+    ioctl(phys_ui, UI_DEV_DESTROY);
+    close(virt_ui);
+    close(phys_ui);
+    return failed > 0;
+}
@@ -0,0 +1,69 @@
+#include "imu.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#define BENCH_SAMPLES (2000000)
+#define BENCH_DT (0.0025f)
+#define BENCH_TOLERANCE (1e-3f)
+
+typedef BasicGamepadMotion<ConstGamepadMotionSettings,
+                           GamepadMotionHelpers::FixedCalibrationMode<IMU_CALIBRATION_MODE>>
+    FixedMotion;
+
+struct BenchResult
+{
+    double ns_per_sample;
+    float gyro[3];
+    float gravity[3];
+};
+
+/* still with some bias and noise, then turning, like a handheld in use */
+template <typename Filter>
+static BenchResult run(Filter &filter)
+{
+    BenchResult result;
+    uint32_t noise = 1;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_SAMPLES; i++)
+    {
+        noise = noise * 1664525 + 1013904223;
+        float n = (noise >> 16) / 65536.0f - 0.5f;
+        float turn = (i / 4000) % 2 ? 30 * sinf(i * BENCH_DT) : 0;
+        filter.ProcessMotion(0.5f + n + turn, -0.3f + n, 0.2f - n,
+                             0.01f * n, -1 + 0.01f * n, 0.02f, BENCH_DT);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    result.ns_per_sample = elapsed.count() / BENCH_SAMPLES;
+    filter.GetCalibratedGyro(result.gyro[0], result.gyro[1], result.gyro[2]);
+    filter.GetGravity(result.gravity[0], result.gravity[1], result.gravity[2]);
+    return result;
+}
+
+/*
+GamepadMotion with runtime settings against the compile time variant
+the IMU uses. Both have to end in the same state, the time per sample is
+only reported, it depends on the build type and the machine
+*/
+int main()
+{
+    GamepadMotion runtime_filter;
+    runtime_filter.SetCalibrationMode(IMU_CALIBRATION_MODE);
+    FixedMotion fixed_filter;
+    auto runtime_result = run(runtime_filter);
+    auto fixed_result = run(fixed_filter);
+    std::cout << "runtime settings: " << runtime_result.ns_per_sample << " ns/sample" << std::endl;
+    std::cout << "fixed settings: " << fixed_result.ns_per_sample << " ns/sample" << std::endl;
+
+    int failed = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (fabsf(runtime_result.gyro[i] - fixed_result.gyro[i]) > BENCH_TOLERANCE ||
+            fabsf(runtime_result.gravity[i] - fixed_result.gravity[i]) > BENCH_TOLERANCE)
+        {
+            std::cout << "axis " << i << " differs between the variants" << std::endl;
+            failed++;
+        }
+    }
+    return failed > 0;
+}
@@ -0,0 +1,191 @@
+#include "iio_backend.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#define TEST_SCANS (10)
+// m/s^2 and rad/s per lsb, as the driver reports them at 2g and 2000dps
+#define TEST_ACCEL_SCALE (0.000598)
+#define TEST_GYRO_SCALE (0.001065)
+// gyro before accel in the scan, a 12 bit accel x in the top of its
+// storage, the timestamp aligned to 8 bytes: 24 byte scans
+#define TEST_SCAN_SIZE (24)
+
+struct TestChannel
+{
+    const char *name;
+    int index;
+    const char *type;
+};
+
+static const TestChannel test_channels[] = {
+    {"in_anglvel_x", 0, "le:s16/16>>0"},
+    {"in_anglvel_y", 1, "le:s16/16>>0"},
+    {"in_anglvel_z", 2, "le:s16/16>>0"},
+    {"in_accel_x", 3, "le:s12/16>>4"},
+    {"in_accel_y", 4, "le:s16/16>>0"},
+    {"in_accel_z", 5, "be:s16/16>>0"},
+    {"in_timestamp", 6, "le:s64/64>>0"},
+};
+
+static void write_file(const std::filesystem::path &path, const std::string &text)
+{
+    std::ofstream file(path);
+    file << text << "\n";
+}
+
+static std::string read_file(const std::filesystem::path &path)
+{
+    std::string text;
+    std::ifstream file(path);
+    std::getline(file, text);
+    return text;
+}
+
+static int16_t test_raw(int scan, int axis)
+{
+    return (scan + 1) * (axis + 1) * (axis % 2 ? -37 : 41);
+}
+
+/* a scan as the kernel packs it for test_channels */
+static void pack_scan(int scan, uint8_t *data)
+{
+    memset(data, 0, TEST_SCAN_SIZE);
+    for (int axis = 0; axis < 6; axis++)
+    {
+        uint16_t raw = test_raw(scan, axis);
+        if (axis == 3)
+            raw = (raw & 0xFFF) << 4;
+        if (axis == 5)
+            raw = raw >> 8 | raw << 8;
+        memcpy(data + axis * 2, &raw, 2);
+    }
+    int64_t timestamp = 1000000000LL + scan * 10000000LL;
+    memcpy(data + 16, &timestamp, 8);
+}
+
+/* a device dir copy: sysfs attributes, a channel we do not use, a recording */
+static std::filesystem::path make_device(const std::filesystem::path &dir)
+{
+    std::filesystem::create_directories(dir / "scan_elements");
+    std::filesystem::create_directories(dir / "buffer");
+    write_file(dir / "name", IIO_DEVICE_NAME);
+    write_file(dir / "in_accel_scale", std::to_string(TEST_ACCEL_SCALE));
+    write_file(dir / "in_anglvel_scale", std::to_string(TEST_GYRO_SCALE));
+    for (const auto &channel : test_channels)
+    {
+        write_file(dir / "scan_elements" / (std::string(channel.name) + "_en"), "0");
+        write_file(dir / "scan_elements" / (std::string(channel.name) + "_index"), std::to_string(channel.index));
+        write_file(dir / "scan_elements" / (std::string(channel.name) + "_type"), channel.type);
+    }
+    write_file(dir / "scan_elements" / "in_temp_en", "1");
+
+    std::ofstream recording(dir / IIO_RECORDING_NAME, std::ios::binary);
+    for (int scan = 0; scan < TEST_SCANS; scan++)
+    {
+        uint8_t data[TEST_SCAN_SIZE];
+        pack_scan(scan, data);
+        recording.write(reinterpret_cast<char *>(data), sizeof(data));
+    }
+    return dir;
+}
+
+static bool close_to(float value, float expected)
+{
+    return fabsf(value - expected) <= fabsf(expected) * 1e-5f + 1e-6f;
+}
+
+/*
+the iio backend on a recorded device dir: only our channels enabled,
+scans unpacked by index order, sign, shift and endianness, scaled to g
+and dps with the kernel's timestamps. A malformed channel index fails
+the open instead of throwing
+*/
+int main()
+{
+    char dir_template[] = "/tmp/iio_backend_test.XXXXXX";
+    if (mkdtemp(dir_template) == nullptr)
+    {
+        std::cout << "iio test dir err!" << std::endl;
+        return 1;
+    }
+    std::filesystem::path root(dir_template);
+    int failed = 0;
+
+    {
+        auto dir = make_device(root / "iio:device0");
+        IioBackend backend(dir.string());
+        if (!backend.isOpen())
+        {
+            std::cout << "iio recording open err!" << std::endl;
+            std::filesystem::remove_all(root);
+            return 1;
+        }
+        for (const auto &channel : test_channels)
+        {
+            if (read_file(dir / "scan_elements" / (std::string(channel.name) + "_en")) != "1")
+            {
+                std::cout << channel.name << " not enabled" << std::endl;
+                failed++;
+            }
+        }
+        if (read_file(dir / "scan_elements" / "in_temp_en") != "0")
+        {
+            std::cout << "in_temp not disabled" << std::endl;
+            failed++;
+        }
+
+        ImuReading readings[TEST_SCANS];
+        size_t count = 0;
+        for (int tries = 0; tries < 10 && count < TEST_SCANS; tries++)
+            count += backend.read(readings + count, TEST_SCANS - count);
+        if (count != TEST_SCANS)
+        {
+            std::cout << "iio read " << count << " scans, expected " << TEST_SCANS << std::endl;
+            failed++;
+        }
+        float accel_scale = TEST_ACCEL_SCALE / GRAVITY_EARTH;
+        float gyro_scale = TEST_GYRO_SCALE * 180 / M_PI;
+        for (size_t i = 0; i < count; i++)
+        {
+            auto &reading = readings[i];
+            // the 12 bit accel x keeps only its low 12 bits, sign extended
+            int16_t accel_x = static_cast<int16_t>(test_raw(i, 3) << 4) >> 4;
+            if (reading.timestamp != 1000000000LL + static_cast<int64_t>(i) * 10000000LL ||
+                !close_to(reading.gyro_x, test_raw(i, 0) * gyro_scale) ||
+                !close_to(reading.gyro_y, test_raw(i, 1) * gyro_scale) ||
+                !close_to(reading.gyro_z, test_raw(i, 2) * gyro_scale) ||
+                !close_to(reading.accel_x, accel_x * accel_scale) ||
+                !close_to(reading.accel_y, test_raw(i, 4) * accel_scale) ||
+                !close_to(reading.accel_z, test_raw(i, 5) * accel_scale))
+            {
+                std::cout << "iio scan " << i << " decoded wrong" << std::endl;
+                failed++;
+            }
+        }
+        if (backend.getHealth().bus_errors != 0)
+        {
+            std::cout << "iio bus errors" << std::endl;
+            failed++;
+        }
+    }
+
+    for (const char *index : {"3x", "", "-1"})
+    {
+        auto dir = make_device(root / "iio:device1");
+        write_file(dir / "scan_elements" / "in_accel_y_index", index);
+        IioBackend backend(dir.string());
+        if (backend.isOpen())
+        {
+            std::cout << "iio opened with index \"" << index << "\"" << std::endl;
+            failed++;
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    std::filesystem::remove_all(root);
+    return failed > 0;
+}
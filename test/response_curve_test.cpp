@@ -0,0 +1,35 @@
+#include "config.hpp"
+#include <iostream>
+
+// the stick mapping before curves, unclamped
+static float linear_range_interp(float min, float max, float target_min, float target_max, float val)
+{
+    return (abs(val) - min) / (max - min) * (target_max - target_min) + target_min;
+}
+
+/*
+the default gyro curve follows the old mapping over the whole stick
+range, in particular past 1.8 where it used to keep rising. The table
+rounds off the corner at 0.1, checked from one step above it
+*/
+int main()
+{
+    ResponseCurve curve(default_gyro_curve_spec());
+    int failed = 0;
+    for (float x = 0.2; x <= 4; x += 0.01)
+    {
+        float expected = std::min(linear_range_interp(0.1, 1.8, 0, 22000, x), 32767.0f);
+        float got = curve(x);
+        if (fabs(got - expected) > 1)
+        {
+            std::cout << "gyro curve at " << x << ": " << got << " expected " << expected << std::endl;
+            failed++;
+        }
+    }
+    if (curve(1.8) < 21999 || curve(10) < 32766)
+    {
+        std::cout << "gyro curve does not reach full deflection" << std::endl;
+        failed++;
+    }
+    return failed > 0;
+}
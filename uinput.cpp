@@ -1,32 +1,30 @@
 #include "uinput.hpp"
 
-float linear_range_interp(float min, float max, float target_min, float target_max, float val)
-{
-    return (abs(val) - min)/(max - min) * (target_max - target_min) + target_min;
-
-}
-
 UInput::UInput(libevdev *src_dev,
                libevdev *fn_dev,
                IMU *imu,
                libevdev_uinput *target_dev,
                libevdev_uinput *mouse_dev,
-               int gyro_deadzone) : src_dev(src_dev),
+               libevdev_uinput *motion_dev) : src_dev(src_dev),
                                              fn_dev(fn_dev),
                                              imu(imu),
                                              target_dev(target_dev),
                                              mouse_dev(mouse_dev),
+                                             motion_dev(motion_dev),
                                              js_switch(true),
                                              gyro_switch(false),
-                                             mouse_rel_x(0),
-                                             mouse_rel_y(0),
+                                             pointer_timer_fd(-1),
+                                             pointer_armed(false),
                                              abs_rx(0),
                                              abs_ry(0),
                                              v_yaw(0),
                                              v_pitch(0),
-                                             gyro_deadzone(gyro_deadzone),
+                                             config(new Config()),
+                                             smoother(make_smoother(config.read()->smoothing)),
+                                             auto_update_gyro_thread_id(0),
                                              left_fn_single_click_thread_id(0),
-                                             right_fn_single_click_thread_id(0)
+                                             right_fn_single_click_thread_id(0),
+                                             ff_bridge(libevdev_uinput_get_fd(target_dev), libevdev_get_fd(src_dev))
 {
   src_fd = libevdev_get_fd(src_dev);
   fn_fd = libevdev_get_fd(fn_dev);
@@ -72,29 +70,51 @@ UInput::UInput(libevdev *src_dev,
                    &UInput::on_read_from_fn_wrap, this);
   }
 
-  // // init callback for target_dev
-  // // read ff event and send to src dev
-  // {
-  //     // start g_io_channel
-  //     auto m_io_channel = g_io_channel_unix_new(libevdev_uinput_get_fd(target_dev));
-
-  //     // set encoding to binary
-  //     GError* error = NULL;
-  //     if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
-  //     {
-  //     std::cout<< error->message << std::endl;
-  //     g_error_free(error);
-  //     }
-
-  //     g_io_channel_set_buffered(m_io_channel, false);
-
-  //     g_io_add_watch(m_io_channel,
-  //                     static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
-  //                     &UInput::on_read_from_target_wrap, this);
-  // }
+  // pointer timer, armed while the sticks move in mouse mode
+  {
+    pointer_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    auto m_io_channel = g_io_channel_unix_new(pointer_timer_fd);
+    g_io_channel_set_encoding(m_io_channel, NULL, NULL);
+    g_io_channel_set_buffered(m_io_channel, false);
+    g_io_add_watch(m_io_channel,
+                   static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                   &UInput::on_pointer_timer_wrap, this);
+  }
+
+  // forward every IMU sample to the motion sensors device
+  if (motion_dev != nullptr)
+    imu->addListener([this](const MotionSample &sample)
+                     { on_motion_sample(sample); });
+  imu->addGestureListener([this](uint32_t gestures)
+                          { on_gestures(gestures); });
+
+  // init callback for target_dev
+  // read ff requests and effects and mirror them on src dev
+  {
+    // start g_io_channel
+    auto m_io_channel = g_io_channel_unix_new(target_fd);
+
+    // set encoding to binary
+    GError *error = NULL;
+    if (g_io_channel_set_encoding(m_io_channel, NULL, &error) != G_IO_STATUS_NORMAL)
+    {
+      std::cout << error->message << std::endl;
+      g_error_free(error);
+    }
+
+    g_io_channel_set_buffered(m_io_channel, false);
+
+    g_io_add_watch(m_io_channel,
+                   static_cast<GIOCondition>(G_IO_IN | G_IO_ERR | G_IO_HUP),
+                   &UInput::on_read_from_target_wrap, this);
+  }
 }
 
-UInput::~UInput(){};
+UInput::~UInput()
+{
+  if (pointer_timer_fd >= 0)
+    close(pointer_timer_fd);
+};
 
 void UInput::run()
 {
@@ -102,6 +122,32 @@ void UInput::run()
   g_main_loop_run(g_main);
 }
 
+const Config *UInput::get_config()
+{
+  return config.read();
+}
+
+/*
+swap in a new config, takes ownership
+*/
+void UInput::set_config(Config *new_config)
+{
+  bool smoothing_changed = new_config->smoothing != config.read()->smoothing;
+  config.update(new_config);
+  // all readers of config run on this thread
+  config.quiesce();
+  config.reclaim();
+  if (smoothing_changed)
+    smoother = make_smoother(new_config->smoothing);
+  // pick up a new pointer rate
+  if (pointer_armed)
+    arm_pointer(true);
+  imu->setSensitivityCurve(new_config->sensitivity_spec);
+  imu->setGyroSpace(new_config->gyro_space);
+  imu->setDemand(IMU_DEMAND_ALWAYS, !new_config->power_save);
+  imu->setDemand(IMU_DEMAND_GESTURES, new_config->gesture_mapping.is_bound());
+}
+
 gboolean UInput::on_read_from_fn(GIOChannel *source, GIOCondition condition)
 {
   // read data
@@ -149,107 +195,104 @@ gboolean UInput::on_read_from_src(GIOChannel *source, GIOCondition condition)
 
   return TRUE;
 }
-// gboolean on_read_from_target(GIOChannel* source, GIOCondition condition)
-// {
-
-// }
-
-bool UInput::parse_as_js(const struct input_event &ev, std::vector<Event> &event_queue)
+gboolean UInput::on_read_from_target(GIOChannel *source, GIOCondition condition)
 {
-  switch (ev.type)
-  {
-  case EV_KEY:
+  // read data
+  struct input_event ev[128];
+  int rd = 0;
+  while ((rd = ::read(target_fd, ev, sizeof(struct input_event) * 128)) > 0)
   {
-    // std::cout << "get key event " << ev.code << std::endl;
-    event_queue.emplace_back(Event(ev.type, ev.code, ev.value));
-    return true;
+    for (size_t i = 0; i < rd / sizeof(struct input_event); ++i)
+      ff_bridge.handle(ev[i]);
   }
-  break;
 
-  case EV_ABS:
-  {
-    if (ev.code == ABS_RX) // cache rx/ry for gyro update
-    {
-      abs_rx = ev.value;
-    } else if (ev.code == ABS_RY)
-    {
-      abs_ry = ev.value;
-    }
-    // std::cout << "get abs event " << ev.code << std::endl;
-    event_queue.emplace_back(Event(ev.type, ev.code, ev.value));
-    return true;
-  }
-  break;
-  default:
-    // not supported event
-    return false;
-    break;
-  }
+  return TRUE;
+}
+
+bool UInput::parse_as_js(const struct input_event &ev, std::vector<Event> &event_queue)
+{
+  return dispatch(config.read()->js_mapping, ev, event_queue);
 }
 
 bool UInput::parse_as_mouse(const struct input_event &ev, std::vector<Event> &event_queue)
 {
-  switch (ev.type)
-  {
-  case EV_KEY:
+  return dispatch(config.read()->mouse_mapping, ev, event_queue);
+}
+
+/*
+look up the compiled action of the event and run it, false if dropped
+*/
+bool UInput::dispatch(const Mapping &mapping, const struct input_event &ev, std::vector<Event> &event_queue)
+{
+  const auto &entry = mapping.lookup(ev.type, ev.code);
+  int out_code = entry.code;
+  switch (entry.action)
   {
-    // std::cout << "get key event " << ev.code << std::endl;
-    switch (ev.code)
-    {
-    case BTN_SOUTH:
-    {
-      event_queue.emplace_back(Event(ev.type, BTN_LEFT, ev.value));
-    }
+  case MAP_NONE:
+    // not supported event
+    return false;
+  case MAP_PASS:
+    out_code = ev.code;
+    event_queue.emplace_back(Event(ev.type, ev.code, ev.value));
     break;
-    case BTN_EAST:
-    {
-      event_queue.emplace_back(Event(ev.type, BTN_RIGHT, ev.value));
-    }
+  case MAP_KEY:
+  case MAP_ABS:
+    event_queue.emplace_back(Event(ev.type, entry.code, ev.value));
     break;
-    case BTN_WEST:
-    {
-      event_queue.emplace_back(Event(ev.type, BTN_MIDDLE, ev.value));
-    }
+  case MAP_REL:
+    // sent repeatedly by on_pointer_timer
+    pointer.set_axis(entry.code, ev.value);
+    if (!pointer_armed)
+      arm_pointer(true);
+    break;
+  case MAP_WHEEL:
+    pointer.set_wheel(ev.value);
+    if (!pointer_armed)
+      arm_pointer(true);
     break;
-    default:
-      // not supported event
-      return false;
-      break;
+  case MAP_AXIS_KEY:
+  {
+    bool pressed = entry.threshold >= 0 ? ev.value > entry.threshold : ev.value < entry.threshold;
+    if (pressed != axis_key_pressed[ev.code])
+    {
+      axis_key_pressed[ev.code] = pressed;
+      event_queue.emplace_back(Event(EV_KEY, entry.code, pressed));
     }
   }
   break;
-
-  case EV_ABS:
-  {
-    switch (ev.code)
-    {
-    case ABS_X:
+  case MAP_MACRO:
+    if (ev.value == 1)
     {
-      mouse_rel_x = static_cast<int>(ev.value / 32768.0 * 7);
+      const auto &keys = mapping.get_macro(entry.macro);
+      for (auto key : keys)
+        event_queue.emplace_back(Event(EV_KEY, key, 1));
+      event_queue.emplace_back(Event(EV_SYN, SYN_REPORT, 0));
+      for (auto key = keys.rbegin(); key != keys.rend(); key++)
+        event_queue.emplace_back(Event(EV_KEY, *key, 0));
     }
     break;
-    case ABS_Y:
-    {
-      mouse_rel_y = static_cast<int>(ev.value / 32768.0 * 7);
-    }
+  case MAP_FN_LEFT:
+    if (ev.value == 1) // only trigger once
+      left_fn_press();
     break;
-    case ABS_RY:
-    {
-      event_queue.emplace_back(Event(EV_REL, REL_WHEEL, ev.value > 1 ? 1 : -1));
-      event_queue.emplace_back(Event(EV_REL, REL_Y, abs(static_cast<int>(ev.value / 32768 * 120))));
-    }
+  case MAP_FN_RIGHT:
+    if (ev.value == 1) // only trigger once
+      right_fn_press();
     break;
-    default:
-      return false;
-      break;
-    }
-  }
-  break;
-  default:
-    // not supported event
-    return false;
+  case MAP_GYRO_TOGGLE:
+    if (ev.value == 1)
+      set_gyro(!gyro_switch);
     break;
   }
+
+  // cache rx/ry for gyro update
+  if (ev.type == EV_ABS && (entry.action == MAP_PASS || entry.action == MAP_ABS))
+  {
+    if (out_code == ABS_RX)
+      abs_rx = ev.value;
+    else if (out_code == ABS_RY)
+      abs_ry = ev.value;
+  }
   return true;
 }
 
@@ -271,15 +314,25 @@ gboolean UInput::left_fn_single_click()
 bool UInput::left_fn_double_click()
 {
   // std::cout << "left_fn_double_click" << std::endl;
-  gyro_switch = !gyro_switch;
+  set_gyro(!gyro_switch);
+  return 0;
+}
+void UInput::set_gyro(bool on)
+{
+  if (on == gyro_switch)
+    return;
+  gyro_switch = on;
+  imu->setDemand(IMU_DEMAND_AIM, on);
   if (gyro_switch)
   {
-    auto_update_gyro_thread_id = g_timeout_add(10, &UInput::auto_update_gyro_wrap, this);
+    imu->getMotion(); // drop motion accumulated while gyro was off
+    smoother->reset();
+    last_gyro_update = std::chrono::steady_clock::now();
+    auto_update_gyro_thread_id = g_timeout_add(GYRO_UPDATE_INTERVAL_MS, &UInput::auto_update_gyro_wrap, this);
   } else {
     g_source_remove(auto_update_gyro_thread_id);
     auto_update_gyro_thread_id = 0;
   }
-  return 0;
 }
 /*
 trigger mapped action(quick menu) with certain delay to ensure
@@ -321,53 +374,135 @@ bool UInput::right_fn_double_click()
 bool UInput::left_right_fn_click()
 {
   // std::cout << "left_right_fn_click" << std::endl;
-  js_switch = !js_switch;
-  if (js_switch) // mouse switch to joystick
+  set_js_mode(!js_switch);
+  return 0;
+}
+void UInput::set_js_mode(bool js)
+{
+  if (js == js_switch)
+    return;
+  js_switch = js;
+  pointer.reset();
+  arm_pointer(false);
+}
+
+void UInput::arm_pointer(bool on)
+{
+  itimerspec spec = {};
+  if (on)
   {
-    mouse_rel_x = 0;
-    mouse_rel_y = 0;
-    if (auto_send_rel_thread_id)
-    {
-      g_source_remove(auto_send_rel_thread_id);
-      auto_send_rel_thread_id = 0;
-    }
-  } else {
-    auto_send_rel_thread_id = g_timeout_add(10, &UInput::auto_send_rel_wrap, this);
+    spec.it_value.tv_nsec = 1000000000L / config.read()->pointer_rate;
+    spec.it_interval = spec.it_value;
+    if (!pointer_armed)
+      last_pointer_tick = std::chrono::steady_clock::now();
   }
-  return 0;
+  if (timerfd_settime(pointer_timer_fd, 0, &spec, NULL) != 0)
+    std::cout << "pointer timer err!" << std::endl;
+  pointer_armed = on;
 }
+
 /*
-send rel event repeatly if raw rel event's value is not zero
+move the pointer by the time since the last tick, stop the timer once
+the sticks are back in the deadzone
 */
-gboolean UInput::auto_send_rel()
+gboolean UInput::on_pointer_timer(GIOChannel *source, GIOCondition condition)
 {
-  if (mouse_rel_x != 0)
-    // std::cout << "auto send rel_x " << mouse_rel_x << std::endl;
-    src_event_queue.emplace_back(Event(EV_REL, REL_X, mouse_rel_x));
-  if (mouse_rel_y != 0)
-    // std::cout << "auto send rel_y " << mouse_rel_y << std::endl;
-    src_event_queue.emplace_back(Event(EV_REL, REL_Y, mouse_rel_y));
-  submit_msg(mouse_dev, src_event_queue);
-  return 1;
+  uint64_t expirations;
+  if (::read(pointer_timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+    return TRUE;
+  auto now = std::chrono::steady_clock::now();
+  // a stalled main loop must not turn into a jump
+  float dt = fmin(std::chrono::duration<float>(now - last_pointer_tick).count(), 0.1f);
+  last_pointer_tick = now;
+
+  if (!pointer.tick(*config.read(), dt, pointer_event_queue))
+    arm_pointer(false);
+  if (!pointer_event_queue.empty())
+    submit_msg(mouse_dev, pointer_event_queue);
+  return TRUE;
+}
+
+/*
+called on the IMU sampling thread, publish calibrated gyro & accel at sensor rate
+*/
+void UInput::on_motion_sample(const MotionSample &sample)
+{
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_X, static_cast<int>(sample.accel_x * MOTION_ACCEL_RES_PER_G)));
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_Y, static_cast<int>(sample.accel_y * MOTION_ACCEL_RES_PER_G)));
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_Z, static_cast<int>(sample.accel_z * MOTION_ACCEL_RES_PER_G)));
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_RX, static_cast<int>(sample.gyro_x * MOTION_GYRO_RES_PER_DPS)));
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_RY, static_cast<int>(sample.gyro_y * MOTION_GYRO_RES_PER_DPS)));
+  motion_event_queue.emplace_back(Event(EV_ABS, ABS_RZ, static_cast<int>(sample.gyro_z * MOTION_GYRO_RES_PER_DPS)));
+  // MSC_TIMESTAMP is in us and expected to wrap around
+  motion_event_queue.emplace_back(Event(EV_MSC, MSC_TIMESTAMP, static_cast<int>(static_cast<uint32_t>(static_cast<uint64_t>(sample.timestamp * 1e6)))));
+  submit_msg(motion_dev, motion_event_queue);
+}
+
+/*
+called on the IMU sampling thread, gestures are collected until the main
+loop dispatches them
+*/
+void UInput::on_gestures(uint32_t gestures)
+{
+  if (pending_gestures.fetch_or(gestures) == 0)
+    g_idle_add(&UInput::dispatch_gestures_wrap, this);
+}
+
+/*
+every gesture is a press and release of its virtual key in [gestures]
+*/
+gboolean UInput::dispatch_gestures()
+{
+  auto gestures = pending_gestures.exchange(0);
+  const auto &mapping = config.read()->gesture_mapping;
+  for (int i = 0; i < IMU_GESTURE_COUNT; i++)
+  {
+    if (!(gestures & (1 << i)))
+      continue;
+    input_event ev = {};
+    ev.type = EV_KEY;
+    ev.code = GESTURE_KEY_BASE + i;
+    for (ev.value = 1; ev.value >= 0; ev.value--)
+    {
+      dispatch(mapping, ev, fn_event_queue);
+      if (!fn_event_queue.empty())
+        submit_msg(target_dev, fn_event_queue);
+    }
+  }
+  return FALSE;
 }
 
 gboolean UInput::auto_update_gyro()
 {
+  auto now = std::chrono::steady_clock::now();
+  float dt = std::chrono::duration<float>(now - last_gyro_update).count();
+  last_gyro_update = now;
+  if (dt <= 0)
+    return 1;
+
+  // smooth as velocity, then back to motion per nominal tick for the curve
   auto v = imu->getMotion();
-  v_yaw = 0.8 * v_yaw + 0.2 * v.yaw;
-  v_pitch = 0.8 * v_pitch + 0.2 * v.pitch;
+  float yaw = v.yaw / dt;
+  float pitch = v.pitch / dt;
+  smoother->filter(yaw, pitch, dt);
+  v_yaw = yaw * GYRO_UPDATE_INTERVAL_MS / 1000.0;
+  v_pitch = pitch * GYRO_UPDATE_INTERVAL_MS / 1000.0;
   auto gyro_norm = sqrt(pow(v_yaw,2) + pow(v_pitch,2));
+  if (gyro_norm == 0)
+    gyro_norm = 1; // no motion, avoid 0/0 below
   auto abs_norm = sqrt(pow(abs_rx,2) + pow(abs_ry,2));
   
-  if (abs_norm <= gyro_deadzone) // abs norm is too small, ignore it
+  auto cfg = config.read();
+  auto scaled_gyro_norm = cfg->gyro_curve(gyro_norm);
+  if (abs_norm <= cfg->gyro_deadzone) // abs norm is too small, ignore it
   {
-    auto scaled_gyro_norm = linear_range_interp(0.1, 1.8, gyro_deadzone, 22000+gyro_deadzone, gyro_norm);
+    // start right outside the game's dead zone
+    scaled_gyro_norm += cfg->gyro_deadzone;
     auto scaled_gyro_yaw = v_yaw / gyro_norm * scaled_gyro_norm;
     auto scaled_gyro_pitch = v_pitch / gyro_norm * scaled_gyro_norm;
     src_event_queue.emplace_back(Event(EV_ABS, ABS_RX, scaled_gyro_yaw));
     src_event_queue.emplace_back(Event(EV_ABS, ABS_RY, scaled_gyro_pitch));
   } else {
-    auto scaled_gyro_norm = linear_range_interp(0.1, 1.8, 0, 22000, gyro_norm);
     auto scaled_gyro_yaw = v_yaw / gyro_norm * scaled_gyro_norm;
     auto scaled_gyro_pitch = v_pitch / gyro_norm * scaled_gyro_norm;
     src_event_queue.emplace_back(Event(EV_ABS, ABS_RX, scaled_gyro_yaw+abs_rx));
@@ -379,70 +514,47 @@ gboolean UInput::auto_update_gyro()
 
 bool UInput::parse_fn(const struct input_event &ev, std::vector<Event> &event_queue)
 {
-  switch (ev.type)
+  // pass through keys go to the gamepad together with src events
+  return dispatch(config.read()->fn_mapping, ev, src_event_queue);
+}
+
+void UInput::left_fn_press()
+{
+  if (right_fn_single_click_thread_id != 0)
   {
-  case EV_KEY:
+    g_source_remove(right_fn_single_click_thread_id);
+    right_fn_single_click_thread_id = 0;
+    left_right_fn_click();
+  }
+  else if (left_fn_single_click_thread_id == 0)
   {
-    // std::cout << "get key event " << ev.code << std::endl;
-    switch (ev.code)
-    {
-    case KEY_D:          // left-bottom
-      if (ev.value == 1) // only trigger once
-      {
-        if (right_fn_single_click_thread_id != 0)
-        {
-          g_source_remove(right_fn_single_click_thread_id);
-          right_fn_single_click_thread_id = 0;
-          left_right_fn_click();
-        }
-        else if (left_fn_single_click_thread_id == 0)
-        {
-          left_fn_single_click_thread_id = g_timeout_add(1000, left_fn_single_click_wrap, this);
-        }
-        else
-        {
-          g_source_remove(left_fn_single_click_thread_id);
-          left_fn_single_click_thread_id = 0;
-          left_fn_double_click();
-        }
-      }
-      break;
-    case KEY_O:          // left-bottom
-      if (ev.value == 1) // only trigger once
-      {
-        if (left_fn_single_click_thread_id != 0)
-        {
-          g_source_remove(left_fn_single_click_thread_id);
-          left_fn_single_click_thread_id = 0;
-          left_right_fn_click();
-        }
-        else if (right_fn_single_click_thread_id == 0)
-        {
-          right_fn_single_click_thread_id = g_timeout_add(1000, right_fn_single_click_wrap, this);
-        }
-        else
-        {
-          g_source_remove(right_fn_single_click_thread_id);
-          right_fn_single_click_thread_id = 0;
-          right_fn_double_click();
-        }
-      }
-      break;
-      case KEY_VOLUMEDOWN: case KEY_VOLUMEUP:
-      {
-        src_event_queue.emplace_back(Event(EV_KEY, ev.code, ev.value));
-      }
-      break;
-    default:
-      break;
-    }
-    return true;
+    left_fn_single_click_thread_id = g_timeout_add(1000, left_fn_single_click_wrap, this);
   }
-  break;
-  default:
-    // not supported event
-    return false;
-    break;
+  else
+  {
+    g_source_remove(left_fn_single_click_thread_id);
+    left_fn_single_click_thread_id = 0;
+    left_fn_double_click();
+  }
+}
+
+void UInput::right_fn_press()
+{
+  if (left_fn_single_click_thread_id != 0)
+  {
+    g_source_remove(left_fn_single_click_thread_id);
+    left_fn_single_click_thread_id = 0;
+    left_right_fn_click();
+  }
+  else if (right_fn_single_click_thread_id == 0)
+  {
+    right_fn_single_click_thread_id = g_timeout_add(1000, right_fn_single_click_wrap, this);
+  }
+  else
+  {
+    g_source_remove(right_fn_single_click_thread_id);
+    right_fn_single_click_thread_id = 0;
+    right_fn_double_click();
   }
 }
 
@@ -455,6 +567,7 @@ bool UInput::submit_msg(libevdev_uinput *ui_dev, std::vector<Event> &event_queue
       std::cout << "error! " << ret << std::endl;
   }
   libevdev_uinput_write_event(ui_dev, EV_SYN, SYN_REPORT, 0);
+  submitted_events.fetch_add(event_queue.size(), std::memory_order_relaxed);
   event_queue.clear();
   return true;
 }
\ No newline at end of file
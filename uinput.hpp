@@ -11,6 +11,19 @@
 #include <iostream>
 #include <map>
 #include "imu/imu.h"
+#include "smoothing.hpp"
+#include "config.hpp"
+#include "ff_bridge.hpp"
+#include "pointer.hpp"
+#include <sys/timerfd.h>
+#include <array>
+#include <bitset>
+
+// resolution of the motion sensors device, units per g and per dps
+#define MOTION_ACCEL_RES_PER_G (8192)
+#define MOTION_GYRO_RES_PER_DPS (1024)
+// stick mapping tick, the gyro curve is tuned for motion per 10ms
+#define GYRO_UPDATE_INTERVAL_MS (10)
 
 struct Event
 {
@@ -26,14 +39,23 @@ private:
     bool js_switch;
     
     int auto_update_gyro_thread_id;
-    int auto_send_rel_thread_id;
     int left_fn_single_click_thread_id;
     int right_fn_single_click_thread_id;
 
-    int mouse_rel_x, mouse_rel_y;
+    // stick to pointer motion, ticked by pointer_timer_fd in mouse mode
+    PointerEngine pointer;
+    int pointer_timer_fd;
+    bool pointer_armed;
+    std::chrono::steady_clock::time_point last_pointer_tick;
+    std::bitset<ABS_CNT> axis_key_pressed;
     int abs_rx, abs_ry;
     float v_yaw, v_pitch;
-    int gyro_deadzone;
+    // read on every event, swapped by set_config
+    Rcu<Config> config;
+    std::unique_ptr<Smoother> smoother;
+    std::chrono::steady_clock::time_point last_gyro_update;
+    // IMU gestures not dispatched yet, set on the IMU sampling thread
+    std::atomic<uint32_t> pending_gestures = 0;
 
     //input devices
     libevdev* src_dev;
@@ -42,9 +64,14 @@ private:
     //output devices
     libevdev_uinput* target_dev;
     libevdev_uinput* mouse_dev;
+    libevdev_uinput* motion_dev;
     int src_fd, fn_fd, target_fd;
     GMainLoop* g_main;
-    std::vector<Event> src_event_queue, fn_event_queue;
+    std::vector<Event> src_event_queue, fn_event_queue, pointer_event_queue;
+    // only touched by the IMU sampling thread
+    std::vector<Event> motion_event_queue;
+    // rumble from games on target_dev, played on src_dev
+    FfBridge ff_bridge;
 
 public:
     UInput(libevdev* src_dev, 
@@ -52,12 +79,23 @@ public:
             IMU* imu,
             libevdev_uinput* target_dev,
             libevdev_uinput* mouse_dev,
-            int gyro_deadzone);
+            libevdev_uinput* motion_dev);
     ~UInput();
     void run();
+    const Config* get_config();
+    void set_config(Config* new_config);
+    bool get_gyro() { return gyro_switch; };
+    void set_gyro(bool on);
+    bool get_js_mode() { return js_switch; };
+    void set_js_mode(bool js);
+    // events written to any output device, also counted on the IMU thread
+    std::atomic<uint64_t> submitted_events = 0;
     bool parse_as_js(const struct input_event& ev, std::vector<Event>& event_queue);
     bool parse_as_mouse(const struct input_event& ev, std::vector<Event>& event_queue);
     bool parse_fn(const struct input_event& ev, std::vector<Event>& event_queue);
+    bool dispatch(const Mapping& mapping, const struct input_event& ev, std::vector<Event>& event_queue);
+    void left_fn_press();
+    void right_fn_press();
     bool submit_msg(libevdev_uinput* ui_dev, std::vector<Event>& event_queue);
     gboolean on_read_from_src(GIOChannel* source, GIOCondition condition);
     static gboolean on_read_from_src_wrap(GIOChannel* source,
@@ -93,10 +131,20 @@ public:
     }
     bool right_fn_double_click();
     bool left_right_fn_click();
-    gboolean auto_send_rel();
-    static gboolean auto_send_rel_wrap(gpointer userdata)
+    void arm_pointer(bool on);
+    gboolean on_pointer_timer(GIOChannel* source, GIOCondition condition);
+    static gboolean on_pointer_timer_wrap(GIOChannel* source,
+                                    GIOCondition condition,
+                                    gpointer userdata)
+    {
+        return static_cast<UInput*>(userdata)->on_pointer_timer(source, condition);
+    }
+    void on_motion_sample(const MotionSample& sample);
+    void on_gestures(uint32_t gestures);
+    gboolean dispatch_gestures();
+    static gboolean dispatch_gestures_wrap(gpointer userdata)
     {
-        return static_cast<UInput*>(userdata)->auto_send_rel();
+        return static_cast<UInput*>(userdata)->dispatch_gestures();
     }
     gboolean auto_update_gyro();
     static gboolean auto_update_gyro_wrap(gpointer userdata)